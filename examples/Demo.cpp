@@ -29,6 +29,7 @@ Demo::Demo(int _argc, char **_argv) :
 }
 
 Demo::~Demo() {
+  stopProcessingThread();
 }
 
 void Demo::runDemo() {
@@ -47,6 +48,7 @@ void Demo::processCommandLineArguments() {
   parser.add<string>("audiodevice", 'd', "Audio device", false);
   parser.add("echo", '\0', "Echo audio input back to output");
   parser.add("showfps", '\0', "Output frame rate to console");
+  parser.add<int>("processingqueue", '\0', "Process audio in a separate thread, queueing up to N buffers", false, 0);
   parser.add<float>("pretrain", '\0', "Pre-train for N seconds", false, 0.0);
   parser.add<int>("width", 'w', "Window width", false, 800);
   parser.add<int>("height", 'h', "Window height", false, 600);
@@ -76,6 +78,8 @@ void Demo::processCommandLineArguments() {
   gridMapParameters.gridHeight = parser.get<int>("gridMapHeight");
   spectrumAnalyzerParameters.windowSize = parser.get<int>("windowSize");
   spectrumAnalyzerParameters.windowOverlap = parser.get<float>("windowOverlap");
+  if(parser.get<int>("processingqueue") > 0)
+    audioEnableProcessingThread(parser.get<int>("processingqueue"));
 
   if(parser.exist("export")) {
     audioEnableVideoExport();
@@ -130,7 +134,10 @@ void Demo::display() {
   if(showFPS) {
     if(frameCount % 100 == 0) {
       float FPS = (float)frameCount / stopwatch.getElapsedMilliseconds() * 1000;
-      printf("fps=%.3f\n", FPS);
+      if(processingThreadEnabled)
+	printf("fps=%.3f overruns=%lu underruns=%lu\n", FPS, getNumAudioOverruns(), getNumAudioUnderruns());
+      else
+	printf("fps=%.3f\n", FPS);
     }
   }
 }
@@ -29,11 +29,12 @@ DemoBrowser::DemoBrowser(int _argc, char **_argv) :
 void DemoBrowser::initializeAudioProcessing() {
   srand((unsigned) time(NULL));
 
-  gridMap = new GridMap(audioParameters, spectrumAnalyzerParameters, gridMapParameters);
-  spectrumAnalyzer = gridMap->getSpectrumAnalyzer();
-  spectrumBinDivider = gridMap->getSpectrumBinDivider();
-  circleMap = new CircleMap(audioParameters, spectrumAnalyzerParameters, circleMapParameters);
-  beatTracker = new BeatTracker(spectrumBinDivider->getNumBins(), audioParameters.bufferSize, audioParameters.sampleRate);
+  spectrumFrontEnd = new SpectrumFrontEnd(audioParameters, spectrumAnalyzerParameters);
+  spectrumAnalyzer = spectrumFrontEnd->getSpectrumAnalyzer();
+  spectrumBinDivider = spectrumFrontEnd->getSpectrumBinDivider();
+  gridMap = new GridMap(spectrumFrontEnd, gridMapParameters);
+  circleMap = new CircleMap(spectrumFrontEnd, circleMapParameters);
+  beatTracker = new BeatTracker(spectrumFrontEnd);
   eventDetector = new EventDetectionPrinter(audioParameters);
   createDisjointGridMap();
 }
@@ -50,8 +51,7 @@ void DemoBrowser::createDisjointGridMap() {
       nodes.push_back(DisjointGridTopology::Node(x, disjointGridMapParameters.gridHeight-(h-y)-1));
     }
   }
-  disjointGridMap = new DisjointGridMap(audioParameters,
-					spectrumAnalyzerParameters,
+  disjointGridMap = new DisjointGridMap(spectrumFrontEnd,
 					disjointGridMapParameters,
 					nodes);
 }
@@ -171,10 +171,7 @@ void DemoBrowser::resizeFrames() {
 }
 
 void DemoBrowser::processDemoAudio(float *inputBuffer) {
-  gridMap->feedAudio(inputBuffer, audioParameters.bufferSize);
-  disjointGridMap->feedAudio(inputBuffer, audioParameters.bufferSize);
-  circleMap->feedAudio(inputBuffer, audioParameters.bufferSize);
-  beatTracker->feedFeatureVector(spectrumBinDivider->getBinValues());
+  spectrumFrontEnd->feedAudio(inputBuffer, audioParameters.bufferSize);
   eventDetector->feedAudio(inputBuffer, audioParameters.bufferSize);
 }
 
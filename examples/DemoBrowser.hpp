@@ -57,6 +57,7 @@ private:
   float SINGLE_FRAME_RELATIVE_SIZE;
   bool normalizeSpectrum;
   GridMapParameters disjointGridMapParameters;
+  SpectrumFrontEnd *spectrumFrontEnd;
   GridMap *gridMap;
   DisjointGridMap *disjointGridMap;
   const SpectrumAnalyzer *spectrumAnalyzer;
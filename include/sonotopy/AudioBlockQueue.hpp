@@ -0,0 +1,53 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _AudioBlockQueue_hpp_
+#define _AudioBlockQueue_hpp_
+
+#include "CircularBuffer.hpp"
+
+namespace sonotopy {
+
+// Fixed-capacity queue of audio blocks for handing input from an audio
+// callback (the single producer) to a processing thread (the single
+// consumer). Both push and pop are wait-free: neither side ever locks or
+// retries, so a slow consumer makes the producer drop blocks instead of
+// stalling it. A polling consumer should pop an empty queue only once a
+// block is overdue, so that underruns count late input rather than polls.
+class AudioBlockQueue {
+public:
+  AudioBlockQueue(unsigned long blockSize, unsigned long numBlocks);
+  bool push(const float *block); // false, and counted as an overrun, if the queue is full
+  bool pop(float *block); // false, and counted as an underrun, if the queue is empty
+  unsigned long getNumQueuedBlocks() const;
+  unsigned long getBlockSize() const { return blockSize; }
+  unsigned long getCapacity() const { return numBlocks; }
+  unsigned long getNumOverruns() const;
+  unsigned long getNumUnderruns() const;
+
+private:
+  unsigned long blockSize;
+  unsigned long numBlocks;
+  CircularBuffer<float> buffer; // the producer owns its writehead, the consumer its readhead
+  unsigned long numPushedBlocks;
+  unsigned long numPoppedBlocks;
+  unsigned long numOverruns;
+  unsigned long numUnderruns;
+};
+
+}
+
+#endif
@@ -18,18 +18,21 @@
 
 #include "Normalizer.hpp"
 #include "Smoother.hpp"
+#include "SpectrumFrontEnd.hpp"
 #include <vector>
 
 namespace sonotopy {
 
-class BeatTracker {
+class BeatTracker : public SpectrumFrontEnd::Consumer {
 public:
   typedef std::vector<float> FeatureVector;
 
   BeatTracker(unsigned int numFeatures, unsigned int windowSize, unsigned int sampleRate);
+  BeatTracker(SpectrumFrontEnd *); // tracks the bin values of the front end, fed by it
   ~BeatTracker();
   void feedFeatureVector(const FeatureVector &);
   void feedFeatureVector(const float *);
+  void feedAnalysis(const SpectrumFrontEnd *, unsigned long numFrames);
   float getIntensity() const;
   void setResponseTimeMs(float);
   void setAdaptationTimeMs(float);
@@ -38,11 +41,13 @@ private:
   const static float DEFAULT_ADAPTATION_TIME_MS;
   const static float DEFAULT_RESPONSE_TIME_MS;
 
+  void initialize();
   float compareFeatures(const FeatureVector &, const FeatureVector &);
 
   unsigned int numFeatures;
   unsigned int windowSize;
   unsigned int sampleRate;
+  SpectrumFrontEnd *frontEnd;
   FeatureVector previousFeatureVector;
   float intensity;
   Normalizer normalizer;
@@ -29,8 +29,13 @@ public:
   CircleMap(const AudioParameters &,
 	    const SpectrumAnalyzerParameters &,
 	    const CircleMapParameters &);
-  float getAngle();
+  CircleMap(SpectrumFrontEnd *,
+	    const CircleMapParameters &);
+  float getAngle(); // feeding thread only, see getActivationPattern
   void write(std::ofstream &f) const;
+
+protected:
+  void getCursorPosition(float &x, float &y);
 };
 
 }
@@ -37,6 +37,11 @@ public:
   float subtractAngle(float, float);
   float clampAngle(float);
 
+protected:
+  bool buildStencil(Stencil &);
+  bool buildOffsetDistanceTable(OffsetDistanceTable &);
+  void findAdjacentNodes(unsigned int nodeId, std::vector<unsigned int> &);
+
 private:
   unsigned int numNodes;
   float maxDistance;
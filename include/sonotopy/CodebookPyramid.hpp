@@ -0,0 +1,70 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _CodebookPyramid_hpp_
+#define _CodebookPyramid_hpp_
+
+#include "SOMKernels.hpp"
+#include <vector>
+
+namespace sonotopy {
+
+// A multi-resolution pyramid over the models of a rectangular grid, where
+// each cell of a coarser level is the mean of a 2x2 block of the level
+// below. Winner search scans the coarsest level exhaustively and then only
+// refines the best beamWidth cells on every finer level, down to the models.
+// Cells are recomputed lazily after the models of a region have changed.
+class CodebookPyramid {
+public:
+  CodebookPyramid(unsigned int gridWidth, unsigned int gridHeight, unsigned int stride);
+  unsigned int getNumLevels() const { return levels.size(); } // not counting the models
+  void invalidate(); // all models have changed
+  void invalidate(unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax); // inclusive
+  void update(const float *models);
+  unsigned int search(const float *models, const float *input, unsigned int beamWidth,
+		      SOMKernels::SquaredDistanceFunction, float &distance);
+
+private:
+  typedef struct {
+    unsigned int width;
+    unsigned int height;
+    std::vector<float> values;
+    std::vector<char> dirty;
+    std::vector<unsigned int> dirtyCells;
+  } Level;
+
+  typedef struct {
+    float distance;
+    unsigned int x;
+    unsigned int y;
+  } Candidate;
+
+  void markDirty(Level &, unsigned int x, unsigned int y);
+  void updateCell(unsigned int levelIndex, unsigned int x, unsigned int y, const float *models);
+  static bool compareCandidates(const Candidate &, const Candidate &);
+
+  unsigned int gridWidth;
+  unsigned int gridHeight;
+  unsigned int stride;
+  std::vector<Level> levels;
+  bool allDirty;
+  std::vector<Candidate> beam;
+  std::vector<Candidate> candidates;
+};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _CompressedCodebook_hpp_
+#define _CompressedCodebook_hpp_
+
+#include "SOM.hpp"
+#include "SOMKernels.hpp"
+#include <vector>
+#include <stddef.h>
+
+namespace sonotopy {
+
+// A read-only copy of a SOM's models in reduced precision, for winner
+// search in deployments that do not train. Half precision halves the
+// codebook size; bytes quarter it, with each dimension quantized linearly
+// between its minimum and maximum over all models.
+class CompressedCodebook {
+public:
+  typedef enum {
+    Half,
+    Byte
+  } Precision;
+
+  typedef struct {
+    unsigned int numInputs;
+    unsigned int numMatchingWinners; // same winner as the full precision search
+    float winnerAgreement; // numMatchingWinners / numInputs
+    float meanOutputIncrease; // mean full precision output of the compressed winner above the true minimum
+    float maxModelError; // largest absolute error of a decoded model value
+  } AccuracyReport;
+
+  CompressedCodebook(const SOM *, Precision);
+  void update(); // encodes the SOM's current models
+  Precision getPrecision() const { return precision; }
+  size_t getNumBytes() const;
+  unsigned int getWinner(const SOM::Sample &) const; // may be called from several threads at once
+  float getModelValue(unsigned int modelId, unsigned int k) const; // decoded
+  AccuracyReport getAccuracy(const std::vector<SOM::Sample> &inputs) const;
+  void setInstructionSet(SOMKernels::InstructionSet);
+
+private:
+  const SOM *som;
+  Precision precision;
+  unsigned int inputSize;
+  unsigned int numModels;
+  unsigned int stride;
+  std::vector<unsigned short> halfModels;
+  std::vector<unsigned char> byteModels;
+  std::vector<float> offsets; // per dimension, for bytes
+  std::vector<float> scales;
+  SOMKernels::HalfSquaredDistanceFunction halfSquaredDistanceKernel;
+  SOMKernels::ByteSquaredDistanceFunction byteSquaredDistanceKernel;
+};
+
+}
+
+#endif
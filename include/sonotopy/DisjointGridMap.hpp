@@ -30,9 +30,13 @@ namespace sonotopy {
 		    const SpectrumAnalyzerParameters &,
 		    const GridMapParameters &,
 		    const std::vector<DisjointGridTopology::Node> &nodes);
+    DisjointGridMap(SpectrumFrontEnd *,
+		    const GridMapParameters &,
+		    const std::vector<DisjointGridTopology::Node> &nodes);
     const SOM::ActivationPattern* getActivationPattern();
 
   protected:
+    void createRectActivationPattern();
     SOM::ActivationPattern rectActivationPattern;
   };
 
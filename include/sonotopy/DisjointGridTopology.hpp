@@ -47,6 +47,10 @@ public:
   void getCursorPosition(float &x, float &y);
   bool containsCoordinates(unsigned int x, unsigned int y);
 
+protected:
+  bool buildOffsetDistanceTable(OffsetDistanceTable &);
+  float offsetToDistance(int dx, int dy) const; // also for offsets between absent nodes
+
 private:
   unsigned int gridWidth;
   unsigned int gridHeight;
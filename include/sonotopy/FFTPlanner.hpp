@@ -0,0 +1,53 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _FFTPlanner_hpp_
+#define _FFTPlanner_hpp_
+
+#include <fftw3.h>
+#include <string>
+
+namespace sonotopy {
+
+// Process-wide cache of FFTW plans. Planning (and wisdom import/export,
+// which FFTW does not make thread-safe either) is serialized behind one
+// lock, so that analyzers can be created from any thread. Plans are shared
+// by all transforms of the same size, and executed with the new-array
+// interface on buffers allocated with fftwf_malloc; they live as long as
+// the process.
+class FFTPlanner {
+public:
+  // Forward real-to-complex plan for transforms of the given size, planned
+  // with FFTW_MEASURE the first time it is requested.
+  static fftwf_plan getRealPlan(int size);
+
+  // Loads wisdom from the file, if it exists, and saves the accumulated
+  // wisdom to it whenever a new plan has been made. An empty filename
+  // stops saving. Returns false if the file exists but can't be read.
+  static bool setWisdomFile(const std::string &filename);
+  static std::string getWisdomFile();
+  static bool saveWisdom(); // false if there's no wisdom file or it can't be written
+
+  static unsigned int getNumPlans();
+
+private:
+  static void lock();
+  static void unlock();
+};
+
+}
+
+#endif
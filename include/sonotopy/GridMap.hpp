@@ -35,13 +35,20 @@ public:
 	  const SpectrumAnalyzerParameters &,
 	  const GridMapParameters &,
 	  Topology *);
+  GridMap(SpectrumFrontEnd *,
+	  const GridMapParameters &);
+  GridMap(SpectrumFrontEnd *,
+	  const GridMapParameters &,
+	  Topology *);
   float getActivation(unsigned int x, unsigned int y);
   const float* getModel(unsigned int x, unsigned int y) const;
-  void getCursor(float &x, float &y);
+  void getCursor(float &x, float &y); // feeding thread only, see getActivationPattern
   const GridMapParameters getParameters() const;
   void write(std::ofstream &f) const;
 
 protected:
+  void getCursorPosition(float &x, float &y);
+
   GridMapParameters gridMapParameters;
 };
 
@@ -0,0 +1,51 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _MirroredCircularBuffer_hpp_
+#define _MirroredCircularBuffer_hpp_
+
+namespace sonotopy {
+
+// A circular buffer whose storage is followed by a mirror of itself, so
+// that the size items from the readhead are always contiguous in memory
+// and can be used in place. Where the system supports it (Linux), the
+// mirror is a second virtual mapping of the same memory; otherwise, and
+// if size items don't fill whole pages, every item is written twice.
+template <class T>
+class MirroredCircularBuffer {
+public:
+  MirroredCircularBuffer(unsigned long size);
+  ~MirroredCircularBuffer();
+  void write(unsigned long n, const T *); // put n items at the end and move the writehead forward
+  void read(unsigned long n, T *) const; // read n <= size items from the readhead, without moving the readhead forward
+  const T *getReadPointer() const { return buffer + readPos; } // size contiguous items from the readhead
+  void moveReadHead(unsigned long n); // move the readhead forward n items
+  bool isMapped() const { return mapped; } // whether the mirror is a second mapping
+
+private:
+  bool map();
+  void writeChunk(unsigned long pos, unsigned long n, const T *);
+
+  unsigned long size;
+  unsigned long writePos;
+  unsigned long readPos;
+  T *buffer; // 2 * size items
+  bool mapped;
+};
+
+}
+
+#endif
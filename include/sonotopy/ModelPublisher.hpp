@@ -0,0 +1,53 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _ModelPublisher_hpp_
+#define _ModelPublisher_hpp_
+
+#include "Publisher.hpp"
+#include <vector>
+
+namespace sonotopy {
+
+// Publishes immutable, versioned copies of a SOM's models from the training
+// thread to reader threads without locks (see Publisher).
+class ModelPublisher {
+public:
+  class Snapshot {
+  public:
+    unsigned long getVersion() const { return version; }
+    const float *getModel(unsigned int id) const { return &data[id * stride]; }
+  private:
+    friend class ModelPublisher;
+    std::vector<float> data;
+    unsigned int stride;
+    unsigned long version;
+  };
+
+  ModelPublisher(unsigned int numModels, unsigned int stride, unsigned int numBuffers = 3);
+  bool publish(const float *modelData, unsigned long version); // false if skipped
+  const Snapshot *acquire() { return publisher.acquire(); } // NULL before the first publication
+  void release(const Snapshot *snapshot) { publisher.release(snapshot); }
+  unsigned long getNumPublications() const { return publisher.getNumPublications(); }
+  unsigned long getNumSkippedPublications() const { return publisher.getNumSkippedPublications(); }
+
+private:
+  Publisher<Snapshot> publisher;
+};
+
+}
+
+#endif
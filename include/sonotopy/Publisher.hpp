@@ -0,0 +1,113 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _Publisher_hpp_
+#define _Publisher_hpp_
+
+#include <vector>
+#include <cstddef>
+
+namespace sonotopy {
+
+// Hands the latest complete value from one writer thread to any number of
+// reader threads without locks. The writer fills a buffer that is neither
+// current nor held by a reader and then makes it current; readers pin the
+// current buffer with a reference count. Neither side ever waits: if every
+// spare buffer is still held, the publication is skipped. With one reader,
+// three buffers make this a triple buffer.
+template <typename ValueType>
+class Publisher {
+public:
+  Publisher(unsigned int numBuffers = 3) {
+    if(numBuffers < 3)
+      numBuffers = 3;
+    slots.resize(numBuffers);
+    for(typename std::vector<Slot>::iterator i = slots.begin(); i != slots.end(); ++i)
+      i->numReaders = 0;
+    current = -1;
+    writing = -1;
+    numPublications = 0;
+    numSkippedPublications = 0;
+  }
+
+  unsigned int getNumBuffers() const { return slots.size(); }
+  ValueType &getBuffer(unsigned int index) { return slots[index].value; } // for setup before publishing
+
+  // writer: a buffer to fill, or NULL if none is free
+  ValueType *beginPublication() {
+    int published = __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+    int numSlots = slots.size();
+    for(int index = 0; index < numSlots; index++) {
+      // a reader that pins this buffer from now on will find that it is
+      // not current and let go of it before reading
+      if(index != published && __atomic_load_n(&slots[index].numReaders, __ATOMIC_SEQ_CST) == 0) {
+	writing = index;
+	return &slots[index].value;
+      }
+    }
+    numSkippedPublications++;
+    return NULL;
+  }
+
+  void endPublication() {
+    __atomic_store_n(&current, writing, __ATOMIC_SEQ_CST);
+    writing = -1;
+    numPublications++;
+  }
+
+  // reader: the current value, NULL before the first publication
+  const ValueType *acquire() {
+    while(true) {
+      int index = __atomic_load_n(&current, __ATOMIC_SEQ_CST);
+      if(index < 0)
+	return NULL;
+      Slot &slot = slots[index];
+      __atomic_add_fetch(&slot.numReaders, 1, __ATOMIC_SEQ_CST);
+      // while pinned and still current, the writer will not touch it
+      if(__atomic_load_n(&current, __ATOMIC_SEQ_CST) == index)
+	return &slot.value;
+      __atomic_sub_fetch(&slot.numReaders, 1, __ATOMIC_SEQ_CST);
+    }
+  }
+
+  void release(const ValueType *value) {
+    for(typename std::vector<Slot>::iterator i = slots.begin(); i != slots.end(); ++i) {
+      if(&i->value == value) {
+	__atomic_sub_fetch(&i->numReaders, 1, __ATOMIC_SEQ_CST);
+	return;
+      }
+    }
+  }
+
+  unsigned long getNumPublications() const { return numPublications; }
+  unsigned long getNumSkippedPublications() const { return numSkippedPublications; }
+
+private:
+  struct Slot {
+    ValueType value;
+    int numReaders;
+  };
+
+  std::vector<Slot> slots;
+  int current; // index of the current slot, -1 before the first publication
+  int writing;
+  unsigned long numPublications;
+  unsigned long numSkippedPublications;
+};
+
+}
+
+#endif
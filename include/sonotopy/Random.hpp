@@ -13,6 +13,46 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
+
+#ifndef _Random_hpp_
+#define _Random_hpp_
+
+#include <stdint.h>
+
 namespace sonotopy {
   float randomInRange(float min, float max);
+
+  // Counter-based random numbers: the value drawn for a counter is a pure
+  // function of the seed and the counter (a SplitMix64 finalizer), so any
+  // part of a stream can be generated independently, on any thread, and
+  // the loop in fillInRange vectorizes.
+  class RandomStream {
+  public:
+    RandomStream(uint64_t _seed = 0) : seed(_seed) {}
+    void setSeed(uint64_t _seed) { seed = _seed; }
+    uint64_t getSeed() const { return seed; }
+
+    uint32_t getBits(uint64_t counter) const {
+      uint64_t z = seed + (counter + 1) * 0x9e3779b97f4a7c15ULL;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return (uint32_t) ((z ^ (z >> 31)) >> 32);
+    }
+
+    // uniform in [min, max), from the top 24 bits
+    float getInRange(uint64_t counter, float min, float max) const {
+      return min + (max - min) * (float) (getBits(counter) >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // values[i] = getInRange(firstCounter + i, min, max)
+    void fillInRange(uint64_t firstCounter, float *values, unsigned int n, float min, float max) const {
+      for(unsigned int i = 0; i < n; i++)
+	values[i] = getInRange(firstCounter + i, min, max);
+    }
+
+  private:
+    uint64_t seed;
+  };
 }
+
+#endif
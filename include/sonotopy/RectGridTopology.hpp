@@ -39,6 +39,11 @@ public:
   void idToGridCoordinates(unsigned int id, unsigned int &x, unsigned int &y);
   void getCursorPosition(float &x, float &y);
 
+protected:
+  bool buildStencil(Stencil &);
+  bool buildOffsetDistanceTable(OffsetDistanceTable &);
+  void findAdjacentNodes(unsigned int nodeId, std::vector<unsigned int> &);
+
 private:
   unsigned int gridWidth;
   unsigned int gridHeight;
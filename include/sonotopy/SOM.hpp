@@ -18,10 +18,17 @@
 
 #include <vector>
 #include "Topology.hpp"
+#include "SOMKernels.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "ModelPublisher.hpp"
 #include <iostream>
 
 namespace sonotopy {
 
+class CodebookPyramid;
+class RectGridTopology;
+
 class SOM {
 public:
   typedef std::vector<float> Sample;
@@ -32,12 +39,28 @@ public:
   SOM(uint inputSize, Topology *);
   ~SOM();
   Topology *getTopology() const;
+  uint getInputSize() const { return inputSize; }
+  uint getNumModels() const { return numModels; }
+  uint getModelStride() const { return modelStride; } // floats per row of model data
   Sample createSample(const float *) const;
   ActivationPattern* createActivationPattern() const;
   void setNeighbourhoodParameter(float); // 0-1
   void setLearningParameter(float); // 0-1
+  float getNeighbourhoodParameter() const { return neighbourhoodParameter; }
+  float getLearningParameter() const { return learningParameter; }
   void train(const Sample &input);
+  // Batch training: the winners of all inputs are searched in one pass
+  // against the models as they were before the batch. With several inputs
+  // the pass is exhaustive, bypassing local and hierarchical search, and
+  // counts as that many full searches. Each model then moves once, towards the mean of the
+  // inputs in whose neighbourhood it lies weighted by strength, by the
+  // learning parameter times their summed strength (at most 1). A batch of
+  // one is ordinary training.
+  void trainBatch(const std::vector<Sample> &inputs);
   const float* getModel(uint id) const;
+  // getWinner and getOutput only read the models, and may run concurrently
+  // with each other but not with training; neither affects the last winner,
+  // output or output range
   uint getWinner(const Sample &input) const;
   uint getLastWinner() const;
   void getOutput(const Sample &input, Output &output) const;
@@ -47,53 +70,175 @@ public:
   void getActivationPattern(ActivationPattern *) const;
   void setModel(uint modelIndex, const Sample &);
   void setAllModels(const Sample &);
+  void setModels(const float *values, uint stride); // numModels rows of stride floats
   void setRandomModelValues(float min = 0, float max = 1);
+  void setRandomSeed(uint64_t); // makes setRandomModelValues independent of rand()
   void writeModelData(std::ostream &) const;
+  void setInstructionSet(SOMKernels::InstructionSet);
+  SOMKernels::InstructionSet getInstructionSet() const;
+  void setNumThreads(uint); // 1 = train on the caller's thread only
+  uint getNumThreads() const;
+
+  // Local winner search: instead of scanning all models, training walks the
+  // topology from the last winner to the locally best matching model. A full
+  // scan is made every fullScanInterval trainings, or when the local winner's
+  // output exceeds errorThreshold. After a local search, the last output,
+  // output range and activation pattern are computed when first read, from
+  // the models as updated by that training.
+  void setLocalSearch(bool enabled, uint fullScanInterval = 16, float errorThreshold = 0.1f);
+  bool isLocalSearchEnabled() const { return localSearchEnabled; }
+  unsigned long getNumLocalSearches() const { return numLocalSearches; }
+  unsigned long getNumFullSearches() const { return numFullSearches; }
+  float getLocalSearchRate() const; // share of searches where the local search was used
+
+  // Hierarchical winner search (rectangular grid topologies only): training
+  // searches a pyramid of averaged models from coarse to fine, keeping the
+  // beamWidth best cells per level. Every verificationInterval trainings the
+  // exhaustive search is used instead and the two winners are compared.
+  // Outputs after a hierarchical search are computed as after a local one.
+  void setHierarchicalSearch(bool enabled, uint beamWidth = 4, uint verificationInterval = 16);
+  bool isHierarchicalSearchEnabled() const { return pyramid != NULL; }
+  unsigned long getNumHierarchicalSearches() const { return numHierarchicalSearches; }
+  unsigned long getNumVerifiedSearches() const { return numVerifiedSearches; }
+  float getHierarchicalSearchAccuracy() const; // share of verified searches that found the exhaustive winner
+
+  // Model publication: after every training, a copy of the models is
+  // published for reader threads, versioned by the number of trainings.
+  // Readers acquire and release snapshots through the publisher.
+  void setModelPublication(bool enabled, uint numBuffers = 3);
+  ModelPublisher *getModelPublisher() const { return modelPublisher; } // NULL unless enabled
+  void publishModels();
+
+  // Dirty tracking: ids of the models changed since the dirty set was last
+  // cleared, in the order they were first changed.
+  void setDirtyTracking(bool enabled);
+  bool isDirtyTrackingEnabled() const { return dirtyTracking; }
+  const std::vector<uint> &getDirtyModels() const { return dirtyModels; }
+  bool isModelDirty(uint id) const { return dirtyTracking && modelDirty[id]; }
+  void clearDirtyModels();
 
 protected:
   class Model;
+  class WinnerSearchTask;
+  class NeighbourUpdateTask;
+  class StencilUpdateTask;
+  class BatchSearchTask;
+  class ModelInitializationTask;
 
   typedef struct {
-    Model *model;
-    float strength; // from 0 to 1 where 1 is nearest neighbour
-  } Neighbour;
+    uint winnerId;
+    float distanceMin, distanceMax; // squared
+  } SearchResult;
 
+  // a model is a view of one row in the parent's model data block
   class Model {
   public:
-    Model(const SOM *som, uint id);
-    ~Model();
-    void updateToInput(const Sample &input);
-    void moveTowards(const std::vector<float > &sample, float amount);
-    float getDistance(const Sample &input);
+    Model(SOM *som, uint id);
+    void updateToInput(const float *paddedInput);
+    void moveTowards(const float *paddedInput, float amount);
     void set(const Sample &);
-    void setRandomValues(float min, float max);
-    void updateNeighbourList();
-    const float* getValues() { return values; }
+    void setRandomValues(const RandomStream &, uint64_t firstCounter, float min, float max);
+    const float* getValues() const { return values; }
     void writeData(std::ostream &) const;
   private:
-    const SOM *parent;
+    SOM *parent;
     uint id;
     uint inputSize;
     float *values;
-    std::vector<Neighbour> neighbours;
-    float neighbourhoodParameter;
   };
 
   void createModels();
   void deleteModels();
-  uint getWinnerAndStoreOutput(const Sample &input, Output &output);
-  void updateNeighbourLists();
+  static uint getPaddedSize(uint size);
+  const float *padInput(const Sample &);
+  uint getWinnerAndStoreDistances(const float *paddedInput, std::vector<float> &squaredDistances);
+  void searchWinner(const float *paddedInput, uint begin, uint end, float *squaredDistances, SearchResult &) const;
+  static void mergeSearchResults(SearchResult &, const SearchResult &);
+  void setOutputRange(const SearchResult &) const;
+  void updateOutputs() const;
+  void searchExhaustively(const float *paddedInput);
+  bool searchLocally(const float *paddedInput);
+  void searchHierarchically(const float *paddedInput);
+  void invalidatePyramid(uint centreId);
+  void modelsMoved(uint centreId);
+  void markNeighbourhoodDirty(uint centreId);
+  void markAllModelsDirty();
+  void markModelDirty(uint id) {
+    if(!modelDirty[id]) {
+      modelDirty[id] = 1;
+      dirtyModels.push_back(id);
+    }
+  }
+  void padBatch(const std::vector<Sample> &);
+  void updateModelNorms();
+  void accumulateBatchUpdate(uint winnerId, const float *paddedInput);
+  void addToBatchMean(uint modelId, const float *paddedInput, float strength);
+  void applyBatchUpdate();
+  void searchWinnersInBatch(uint numSamples, uint begin, uint end, SearchResult *results,
+			    float *lastSquaredDistances) const;
+  void applyStencil(const Topology::Stencil &, uint centreId, const float *paddedInput,
+		    uint rowBegin, uint rowEnd);
 
   uint inputSize;
   Topology *topology;
   uint numModels;
   float neighbourhoodParameter;
   float learningParameter;
-  std::vector<Model *> models;
+  std::vector<Model> models;
+  uint modelStride; // inputSize padded to a whole number of cache lines
+  float *modelData; // numModels rows of modelStride floats, cache line aligned
+  float *paddedInput; // one more row after the models, zero-padded like them; training input only
+  void *modelDataAllocation;
+  float *batchData; // padded inputs of the current batch
+  void *batchDataAllocation;
+  uint batchCapacity;
+  std::vector<float> batchNorms;
+  std::vector<float> modelNorms;
+  std::vector<float> batchMeans; // per model, the strength-weighted mean of the inputs reaching it
+  std::vector<float> batchStrengths; // per model, the summed strength of those inputs
+  std::vector<uint> batchModels; // models reached by the current batch
+  SOMKernels::InstructionSet instructionSet;
+  SOMKernels::SquaredDistanceFunction squaredDistanceKernel;
+  SOMKernels::MoveTowardsFunction moveTowardsKernel;
+  SOMKernels::DotProductFunction dotProductKernel;
+  SOMKernels::ScaledRootFunction scaledRootKernel;
+  ThreadPool *threadPool;
+  // model initialization: value k of model i is drawn from counter
+  // (numRandomInitializations * numModels + i) * inputSize + k, so the
+  // models don't depend on the number of threads. Unless a seed has been
+  // set, the stream is seeded from rand() on every initialization.
+  RandomStream randomStream;
+  bool randomSeedSet;
+  unsigned long numRandomInitializations;
   float maxDistance; // max distance in euclidian space between two samples
   uint lastWinnerId;
-  Output lastOutput;
-  float outputMin, outputMax;
+  bool localSearchEnabled;
+  uint fullScanInterval;
+  float localSearchErrorThreshold;
+  uint numSearchesSinceFullScan;
+  unsigned long numLocalSearches;
+  unsigned long numFullSearches;
+  CodebookPyramid *pyramid; // NULL unless the hierarchical search is enabled
+  RectGridTopology *gridTopology;
+  uint beamWidth;
+  uint verificationInterval;
+  uint numSearchesSinceVerification;
+  unsigned long numHierarchicalSearches;
+  unsigned long numVerifiedSearches;
+  unsigned long numCorrectVerifiedSearches;
+  ModelPublisher *modelPublisher;
+  unsigned long numTrainings;
+  bool dirtyTracking;
+  std::vector<char> modelDirty;
+  std::vector<uint> dirtyModels;
+  // squared distances of the last exhaustive search; outputs and the
+  // activation pattern are only derived from them when requested. The
+  // accessors of the last output belong to the training thread, as they
+  // may have to fill these in.
+  mutable std::vector<float> lastSquaredDistances;
+  mutable float outputMin, outputMax;
+  mutable bool outputsOutdated; // lastSquaredDistances predate the last training
+
 };
 
 }
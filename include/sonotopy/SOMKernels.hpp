@@ -0,0 +1,71 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _SOMKernels_hpp_
+#define _SOMKernels_hpp_
+
+namespace sonotopy {
+
+// Inner loops of the SOM, with vectorized variants selected at runtime
+// depending on which instruction sets the CPU supports.
+class SOMKernels {
+public:
+  typedef enum {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+  } InstructionSet;
+
+  typedef float (*SquaredDistanceFunction)(const float *model, const float *input, unsigned int size);
+  typedef void (*MoveTowardsFunction)(float *model, const float *input, unsigned int size, float amount);
+  typedef float (*DotProductFunction)(const float *a, const float *b, unsigned int size);
+  // output[i] = offset + scale * sqrt(squaredDistances[i]); output may alias squaredDistances
+  typedef void (*ScaledRootFunction)(const float *squaredDistances, float *output, unsigned int size,
+				     float scale, float offset);
+  // distance to a model stored as IEEE half precision values
+  typedef float (*HalfSquaredDistanceFunction)(const unsigned short *model, const float *input, unsigned int size);
+  // distance to a model stored as bytes q, decoded as scale * q, from an
+  // input with the per-dimension offset already subtracted
+  typedef float (*ByteSquaredDistanceFunction)(const unsigned char *model, const float *scale,
+					       const float *shiftedInput, unsigned int size);
+
+  static InstructionSet getBestInstructionSet();
+  static bool isSupported(InstructionSet);
+  static const char *getName(InstructionSet);
+  static SquaredDistanceFunction getSquaredDistanceFunction(InstructionSet);
+  static MoveTowardsFunction getMoveTowardsFunction(InstructionSet);
+  static DotProductFunction getDotProductFunction(InstructionSet);
+  static ScaledRootFunction getScaledRootFunction(InstructionSet);
+
+  // Variants for one fixed size, with loops unrolled at compile time, if
+  // hasFixedSizeKernels(size); else the generic functions. The functions
+  // returned must only be called with that size.
+  static bool hasFixedSizeKernels(unsigned int size);
+  static SquaredDistanceFunction getSquaredDistanceFunction(InstructionSet, unsigned int size);
+  static MoveTowardsFunction getMoveTowardsFunction(InstructionSet, unsigned int size);
+  static DotProductFunction getDotProductFunction(InstructionSet, unsigned int size);
+
+  static HalfSquaredDistanceFunction getHalfSquaredDistanceFunction(InstructionSet);
+  static ByteSquaredDistanceFunction getByteSquaredDistanceFunction(InstructionSet);
+
+  static unsigned short floatToHalf(float);
+  static float halfToFloat(unsigned short);
+};
+
+}
+
+#endif
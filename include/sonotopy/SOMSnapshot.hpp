@@ -0,0 +1,89 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _SOMSnapshot_hpp_
+#define _SOMSnapshot_hpp_
+
+#include "SOM.hpp"
+#include <iostream>
+#include <stdint.h>
+
+namespace sonotopy {
+
+// A binary snapshot of a SOM: a fixed header, the model rows exactly as
+// the SOM stores them (cache line aligned, padded rows), and an optional
+// block of application state. A loaded snapshot is memory-mapped, so its
+// models can be used in place or restored into a SOM without parsing.
+class SOMSnapshot {
+public:
+  static const uint32_t version = 1;
+
+  typedef enum {
+    UnknownTopology,
+    RectGrid,
+    Circle,
+    DisjointGrid
+  } TopologyType;
+
+  typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t topologyType;
+    uint32_t topologyWidth; // grid width, or number of nodes
+    uint32_t topologyHeight; // grid height, or 1
+    uint32_t inputSize;
+    uint32_t numModels;
+    uint32_t modelStride; // floats per model row
+    uint64_t modelDataOffset; // bytes from the start of the file
+    uint64_t stateOffset;
+    uint32_t stateSize;
+    float neighbourhoodParameter;
+    float learningParameter;
+    uint32_t checksum; // CRC-32 of everything after the header
+    uint32_t headerChecksum; // CRC-32 of the header up to this field
+    uint32_t reserved;
+  } Header;
+
+  static void write(const SOM &, std::ostream &, const void *state = NULL, uint32_t stateSize = 0);
+  static void write(const SOM &, const char *filename, const void *state = NULL, uint32_t stateSize = 0);
+
+  SOMSnapshot(const char *filename, bool verifyChecksum = true);
+  ~SOMSnapshot();
+  const Header &getHeader() const { return *header; }
+  const float *getModel(unsigned int id) const { return models + id * header->modelStride; }
+  const void *getState() const { return state; }
+  uint32_t getStateSize() const { return header->stateSize; }
+  void restore(SOM &) const; // the SOM must have the same dimensions
+
+  static uint32_t crc32(const void *data, size_t size, uint32_t crc = 0);
+
+private:
+  SOMSnapshot(const SOMSnapshot &); // owns the mapping, so not copyable
+  SOMSnapshot &operator=(const SOMSnapshot &);
+  void validate(bool verifyChecksum);
+
+  void *data;
+  size_t size;
+  bool mapped;
+  const Header *header;
+  const float *models;
+  const void *state;
+};
+
+}
+
+#endif
@@ -23,7 +23,9 @@ public:
   Smoother();
   float smooth(float);
   void setResponseFactor(float);
-  float getValue();
+  float getValue() const;
+  bool isInitialized() const { return initialized; }
+  void setValue(float); // as if it had already smoothed up to this value
 
 private:
   float responseFactor;
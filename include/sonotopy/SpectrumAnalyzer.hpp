@@ -17,22 +17,38 @@
 #define _SpectrumAnalyzer_hpp_
 
 #include "SpectrumAnalyzerParameters.hpp"
-#include "CircularBuffer.hpp"
+#include "MirroredCircularBuffer.hpp"
 #include <fftw3.h>
+#include <vector>
 
 namespace sonotopy {
 
 class SpectrumAnalyzer {
 public:
+  typedef std::vector<float *>::const_iterator SpectrumIterator;
+
   SpectrumAnalyzer(const SpectrumAnalyzerParameters &);
   ~SpectrumAnalyzer();
   void feedAudioFrames(const float *input, unsigned long numFrames);
-  float *getSpectrum() const { return spectrum; }
+  float *getSpectrum() const { return spectrum; } // of the newest hop
+  // spectra of the hops completed by the last feedAudioFrames call, oldest
+  // first; with LatestHopOnly, at most the newest one
+  SpectrumIterator beginSpectra() const { return hopSpectra.begin(); }
+  SpectrumIterator endSpectra() const { return hopSpectra.begin() + numHopSpectra; }
+  unsigned long getNumSpectra() const { return numHopSpectra; }
   int getWindowSize() const { return windowSize; }
   int getSpectrumResolution() const { return spectrumResolution; }
   PowerScale getPowerScale() const { return powerScale; }
   void setDecibelReference(double dB_reference);
-  float *getInputWindow() const { return inputHistoryBuffer; }
+  // from now on, only the given spectrum positions (ascending) are
+  // power-scaled and the others read as zero; an empty support restores the
+  // full spectrum. The whole transform still runs, so this saves little on
+  // a dense support such as that of the default bins (92% of the
+  // positions); "performanceTest -fe" measures it
+  void setSpectrumSupport(const std::vector<unsigned int> &positions);
+  bool isSparse() const { return !spectrumSupport.empty(); }
+  // the windowSize most recent frames up to the last FFT, oldest first
+  const float *getInputWindow() const { return inputHistory->getReadPointer(); }
 
 private:
   typedef double (SpectrumAnalyzer::*PowerScalingFunction)(double);
@@ -42,24 +58,32 @@ private:
   WindowFunction windowFunction;
   int windowSize;
   float windowOverlap;
+  HopPolicy hopPolicy;
   unsigned long spectrumResolution;
-  CircularBuffer<float> *inputHistory;
-  float *inputHistoryBuffer;
-  fftw_plan fftPlan;
-  fftw_complex *fftIn, *fftOut;
+  MirroredCircularBuffer<float> *inputHistory; // windowed in place, without copying
+  fftwf_plan fftPlan; // shared, from FFTPlanner
+  float *fftIn; // windowed input
+  fftwf_complex *fftOut; // windowSize/2 + 1 bins of the real-input transform
   float *spectrum;
+  std::vector<float *> hopSpectra; // with EveryHop, grown to the most hops completed in one call
+  unsigned long numHopSpectra;
+  std::vector<unsigned int> spectrumSupport;
   double fftOutMax;
   double dB_reference;
   double log10_min, log10_scalefactor;
-  double *windowFunctionTable;
+  float *windowFunctionTable;
   unsigned long numUnconsumedFrames;
   unsigned long numNewFramesPerFFT;
 
   void appendAudioToHistory(const float *input, unsigned long numFrames);
   void processUnconsumedFrames();
-  void performFFT();
+  void feedAudioFramesHopByHop(const float *input, unsigned long numFrames);
+  float *getNextHopSpectrum();
+  void performFFT(float *destination);
   void inputHistoryToFftIn();
-  void fftOutToSpectrum();
+  void fftOutToSpectrum(float *destination);
+  void fftOutToSparseSpectrum(float *destination);
+  void clearSpectra();
   void createBlackmanHarrisWindowFunctionTable();
   double powerToDB(double);
   double powerToAmplitude(double);
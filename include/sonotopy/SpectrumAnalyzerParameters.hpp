@@ -28,6 +28,11 @@ namespace sonotopy {
     BlackmanHarris
   } WindowFunction;
 
+  typedef enum {
+    LatestHopOnly, // when several hops are pending, only the newest window is transformed
+    EveryHop
+  } HopPolicy;
+
 
   class SpectrumAnalyzerParameters {
   public:
@@ -36,12 +41,16 @@ namespace sonotopy {
       windowFunction = BlackmanHarris;
       windowSize = 16384;
       windowOverlap = (float) 15/16;
+      hopPolicy = LatestHopOnly;
+      sparseSpectrum = false;
     }
 
     PowerScale powerScale;
     WindowFunction windowFunction;
     int windowSize;
     float windowOverlap;
+    HopPolicy hopPolicy;
+    bool sparseSpectrum; // output only the spectrum positions used by the spectrum bin divider
   };
 
 }
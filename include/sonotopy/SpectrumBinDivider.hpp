@@ -35,9 +35,12 @@ public:
   int getSampleRate() { return sampleRate; }
   void feedSpectrum(const float *spectrum, unsigned long numFrames);
   float *getBinValues() const { return binValues; }
+  void setBinValues(const float *); // restores the integrated values, numBins floats
   unsigned int getNumBins() const { return numBins; }
   void setIntegrationTimeMs(float);
   float getIntegrationTimeMs() const { return integrationTimeMs; }
+  // spectrum positions connected to at least one bin, in ascending order
+  const std::vector<unsigned int> &getSpectrumSupport() const { return spectrumSupport; }
 
 private:
   typedef struct {
@@ -60,6 +63,7 @@ private:
     std::vector<BinConnection> binConnections;
   } SpectrumPosition;
   SpectrumPosition *spectrumPositions;
+  std::vector<unsigned int> spectrumSupport;
 
   int sampleRate;
   unsigned int spectrumResolution;
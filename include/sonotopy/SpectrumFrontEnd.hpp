@@ -0,0 +1,59 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _SpectrumFrontEnd_hpp_
+#define _SpectrumFrontEnd_hpp_
+
+#include "AudioParameters.hpp"
+#include "SpectrumAnalyzerParameters.hpp"
+#include "SpectrumAnalyzer.hpp"
+#include "SpectrumBinDivider.hpp"
+#include <vector>
+
+namespace sonotopy {
+
+// Spectrum analysis and bin division shared by several consumers of the
+// same audio, so that the FFT runs once per buffer rather than once per
+// map. Consumers attach themselves and are fed in the order they attached.
+class SpectrumFrontEnd {
+public:
+  class Consumer {
+  public:
+    virtual ~Consumer() {}
+    virtual void feedAnalysis(const SpectrumFrontEnd *, unsigned long numFrames) = 0;
+  };
+
+  SpectrumFrontEnd(const AudioParameters &, const SpectrumAnalyzerParameters &);
+  ~SpectrumFrontEnd();
+  void feedAudio(const float *audio, unsigned long numFrames);
+  void attach(Consumer *);
+  void detach(Consumer *);
+  const AudioParameters &getAudioParameters() const { return audioParameters; }
+  SpectrumAnalyzer *getSpectrumAnalyzer() const { return spectrumAnalyzer; }
+  SpectrumBinDivider *getSpectrumBinDivider() const { return spectrumBinDivider; }
+  const float *getSpectrum() const { return spectrumAnalyzer->getSpectrum(); }
+  const float *getBinValues() const { return spectrumBinDivider->getBinValues(); }
+
+private:
+  AudioParameters audioParameters;
+  SpectrumAnalyzer *spectrumAnalyzer;
+  SpectrumBinDivider *spectrumBinDivider;
+  std::vector<Consumer *> consumers;
+};
+
+}
+
+#endif
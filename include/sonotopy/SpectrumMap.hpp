@@ -22,25 +22,48 @@
 #include "Topology.hpp"
 #include "SpectrumAnalyzer.hpp"
 #include "SpectrumBinDivider.hpp"
+#include "SpectrumFrontEnd.hpp"
 #include "SOM.hpp"
 #include "Smoother.hpp"
+#include "Publisher.hpp"
 #include <vector>
 #include <fstream>
 
 namespace sonotopy {
 
-class SpectrumMap {
+class SpectrumMap : public SpectrumFrontEnd::Consumer {
 public:
+  // the output of one audio buffer, as seen by render threads
+  typedef struct {
+    SOM::ActivationPattern activationPattern; // by node id
+    int winnerId;
+    float cursorX, cursorY; // as from getCursor (GridMap) or getAngle (CircleMap, in cursorX)
+    float elapsedTimeSecs;
+  } Frame;
+
   SpectrumMap(Topology *,
 	      const AudioParameters &,
 	      const SpectrumAnalyzerParameters &,
 	      const SpectrumMapParameters &);
+
+  // A map fed by a shared front end: the map attaches itself and is trained
+  // whenever the front end is fed. The front end is not owned, must outlive
+  // the map, and its spectrum integration time is shared by all its maps.
+  SpectrumMap(Topology *,
+	      SpectrumFrontEnd *,
+	      const SpectrumMapParameters &);
   ~SpectrumMap();
+  void feedAnalysis(const SpectrumFrontEnd *, unsigned long numFrames);
   void feedAudio(const float *audio, unsigned long numFrames);
+  void feedAudioBlock(const float *audio, unsigned long numFrames); // trains once per bufferSize frames, as one batch
   int getWinnerId() const;
   const SpectrumAnalyzer* getSpectrumAnalyzer() { return spectrumAnalyzer; }
   const SpectrumBinDivider* getSpectrumBinDivider() { return spectrumBinDivider; }
+  SOM* getSom() { return som; }
   int getSpectrumResolution() const { return spectrumResolution; }
+  // getActivationPattern and the cursor accessors of the subclasses update
+  // state of the map, and must only be called from the thread that feeds
+  // it; other threads read published frames instead
   virtual const SOM::ActivationPattern* getActivationPattern();
   Topology* getTopology() const;
   void setSpectrumIntegrationTimeMs(float);
@@ -53,21 +76,39 @@ public:
   SpectrumMapParameters getSpectrumMapParameters() const;
   void resetAdaptation();
   virtual void write(std::ofstream &f) const {}
+
+  // Binary snapshot of the models and the adaptation state (elapsed time,
+  // error level and spectrum integration). Restoring it right after
+  // construction skips the initial training phase. A map fed by a front end
+  // leaves the front end's spectrum integration as it is.
+  void writeSnapshot(const char *filename) const;
+  void restoreSnapshot(const char *filename);
+
+  // Frame publication: after every fed buffer, the audio thread publishes
+  // the activation pattern, winner and cursor, computed straight into the
+  // frame. Readers on other threads get the latest frame without locking
+  // or copying, and release it when done.
+  void setFramePublication(bool enabled, unsigned int numBuffers = 3);
+  const Frame *acquireFrame(); // NULL before the first frame, or if disabled
+  void releaseFrame(const Frame *);
   void writeActivationPattern(std::ofstream &f);
 
 protected:
+  void initialize();
   void createSpectrumAnalyzer(const SpectrumAnalyzerParameters &);
   void createSpectrumBinDivider();
   void createSom();
   void createSomInput();
-  void createSomOutput();
   void feedSpectrumToSom(const float *spectrum);
+  void trainOnBinValues(unsigned long numFrames);
   void spectrumToSomInput(const float *);
   void setTrainingParameters(unsigned long numFrames);
   float getLearningParameter(float adaptationTimeSecs, unsigned long numFrames);
   void setTimeBasedAdaptationValues();
   void setErrorDrivenAdaptationValues();
   float clamp(float in, float min, float max) const;
+  void publishFrame();
+  virtual void getCursorPosition(float &x, float &y) { x = y = 0; }
 
   AudioParameters audioParameters;
   SpectrumMapParameters spectrumMapParameters;
@@ -75,11 +116,12 @@ protected:
   Topology *topology;
   int spectrumResolution;
   SOM::Sample somInput;
-  SOM::Output somOutput;
+  std::vector<SOM::Sample> somInputBatch;
   SOM::ActivationPattern *currentActivationPattern;
   SOM::ActivationPattern *nextActivationPattern;
   SpectrumAnalyzer *spectrumAnalyzer;
   SpectrumBinDivider *spectrumBinDivider;
+  SpectrumFrontEnd *frontEnd; // NULL if the map owns its analysis
   const float *spectrum;
   const float *spectrumBinValues;
   float elapsedTimeSecs;
@@ -89,6 +131,7 @@ protected:
   float adaptationTimeSecs;
   float errorLevel;
   Smoother errorLevelSmoother;
+  Publisher<Frame> *framePublisher;
 };
 
 }
@@ -33,6 +33,8 @@ public:
 
   float trajectorySmoothness;
   AdaptationStrategy adaptationStrategy;
+  unsigned int numThreads; // threads used for SOM training
+  unsigned long randomSeed; // seeds the initial models; 0 = seeded from rand()
 
   // parameters for time-based adaptation
   float initialTrainingLengthSecs;
@@ -0,0 +1,69 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef _ThreadPool_hpp_
+#define _ThreadPool_hpp_
+
+#include <pthread.h>
+#include <vector>
+
+namespace sonotopy {
+
+// Runs a task over an index range split into contiguous chunks, one per
+// thread. The calling thread processes the first chunk itself, so a pool
+// of N threads starts N-1 workers.
+class ThreadPool {
+public:
+  class Task {
+  public:
+    virtual ~Task() {}
+    // process items [begin, end); chunk is the index of the chunk (0 to numChunks-1)
+    virtual void run(unsigned int chunk, unsigned int begin, unsigned int end) = 0;
+  };
+
+  ThreadPool(unsigned int numThreads);
+  ~ThreadPool();
+  unsigned int getNumThreads() const { return numThreads; }
+  unsigned int getNumChunks(unsigned int numItems, unsigned int minItemsPerChunk = 1) const;
+  void run(Task &, unsigned int numItems, unsigned int minItemsPerChunk = 1);
+
+private:
+  typedef struct {
+    ThreadPool *pool;
+    unsigned int index;
+  } WorkerContext;
+
+  static void *workerMain(void *);
+  void work(unsigned int workerIndex);
+  void runChunk(unsigned int chunk);
+
+  unsigned int numThreads;
+  std::vector<pthread_t> workers;
+  std::vector<WorkerContext> workerContexts;
+  pthread_mutex_t mutex;
+  pthread_cond_t taskAvailable;
+  pthread_cond_t taskCompleted;
+  unsigned long generation;
+  unsigned int numPendingChunks;
+  bool stopping;
+  Task *task;
+  unsigned int numItems;
+  unsigned int numChunks;
+};
+
+}
+
+#endif
@@ -27,15 +27,113 @@ public:
     double strength; // from 0 to 1 where 1 is nearest neighbour
   } Neighbour;
 
+  // A translation-invariant neighbourhood on a row-major grid of nodes,
+  // stored as one span of strengths per row offset. The centre (dx = dy = 0)
+  // has strength 1. Rows are clipped at the grid border; columns wrap
+  // around if wrapAround is set.
+  typedef struct {
+    int dy;
+    int dxMin;
+    std::vector<float> strengths; // for dx = dxMin, dxMin + 1, ...
+  } StencilRow;
+
+  typedef struct {
+    unsigned int width;
+    unsigned int height;
+    bool wrapAround;
+    std::vector<StencilRow> rows;
+  } Stencil;
+
+  // Distances that only depend on the offset between node coordinates:
+  // the distance between nodes a and b is
+  // distances[|y[a] - y[b]| * width + |x[a] - x[b]|].
+  typedef struct {
+    std::vector<int> x, y; // per node
+    unsigned int width;
+    std::vector<float> distances; // per absolute offset
+  } OffsetDistanceTable;
+
+  Topology();
+  virtual ~Topology() {}
   void getNeighbours(unsigned int nodeId, std::vector<Neighbour> &);
+  const std::vector<Neighbour> &getNeighbours(unsigned int nodeId); // cached until the vicinity level changes
+  const Stencil *getStencil(); // NULL unless the topology is translation-invariant
+  const std::vector<unsigned int> &getAdjacentNodes(unsigned int nodeId); // cached
   void setVicinityFactor(float);
+  float getVicinityFactor() const { return vicinityFactor; }
+  unsigned int getVicinityLevel() const { return vicinityLevel; }
   virtual unsigned int getNumNodes() { return 0; }
   virtual float getDistance(unsigned int sourceNodeId, unsigned int targetNodeId) { return 0.0f; }
+
+  // Same as getDistance, but non-virtual and read from a table built on
+  // first use: per coordinate offset if the topology provides one, else
+  // per node pair for topologies of up to 1024 nodes. Larger irregular
+  // topologies fall back to getDistance, which must therefore compute the
+  // distance itself rather than call this.
+  float lookupDistance(unsigned int sourceNodeId, unsigned int targetNodeId) {
+    switch(distanceTableType) {
+    case OffsetDistances: {
+      int dx = offsetDistanceTable.x[sourceNodeId] - offsetDistanceTable.x[targetNodeId];
+      int dy = offsetDistanceTable.y[sourceNodeId] - offsetDistanceTable.y[targetNodeId];
+      if(dx < 0) dx = -dx;
+      if(dy < 0) dy = -dy;
+      return offsetDistanceTable.distances[dy * offsetDistanceTable.width + dx];
+    }
+    case PairDistances:
+      return pairDistances[sourceNodeId * numPairDistanceNodes + targetNodeId];
+    case NoDistanceTable:
+      return getDistance(sourceNodeId, targetNodeId);
+    default:
+      createDistanceTable();
+      return lookupDistance(sourceNodeId, targetNodeId);
+    }
+  }
   virtual void placeCursorAtNode(unsigned int nodeId) {}
   virtual void moveCursorTowardsNode(unsigned int nodeId, float amount) {}
 
-private:
+  // the vicinity factor is quantized to this many levels, so that
+  // neighbour lists can be reused while it only changes marginally
+  static const unsigned int numVicinityLevels = 4096;
+
+protected:
+  typedef struct {
+    float distance;
+    unsigned int nodeId;
+  } NodeDistance;
+
+  virtual void findNeighbours(unsigned int nodeId, std::vector<Neighbour> &);
+  virtual bool buildStencil(Stencil &) { return false; }
+  virtual bool buildOffsetDistanceTable(OffsetDistanceTable &) { return false; }
+  virtual void findAdjacentNodes(unsigned int nodeId, std::vector<unsigned int> &);
+  void stencilToNeighbours(const Stencil &, unsigned int nodeId, std::vector<Neighbour> &);
+  const std::vector<NodeDistance> &getNodesByDistance(unsigned int nodeId);
+
   float vicinityFactor;
+  unsigned int vicinityLevel;
+
+private:
+  typedef enum {
+    DistanceTableNotCreated,
+    OffsetDistances,
+    PairDistances,
+    NoDistanceTable
+  } DistanceTableType;
+
+  void createDistanceTable();
+  static bool compareNodeDistances(const NodeDistance &, const NodeDistance &);
+  void createCaches();
+
+  std::vector<std::vector<Neighbour> > cachedNeighbours;
+  std::vector<unsigned int> cachedNeighboursLevel;
+  std::vector<std::vector<NodeDistance> > nodesByDistance;
+  std::vector<std::vector<unsigned int> > adjacentNodes;
+  Stencil stencil;
+  unsigned int stencilLevel;
+  bool hasStencil;
+  DistanceTableType distanceTableType;
+  OffsetDistanceTable offsetDistanceTable;
+  std::vector<float> pairDistances;
+  unsigned int numPairDistanceNodes;
 };
 
 }
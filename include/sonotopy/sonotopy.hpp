@@ -20,6 +20,8 @@
 #include <sonotopy/CircleMap.hpp>
 #include <sonotopy/GridMap.hpp>
 #include <sonotopy/DisjointGridMap.hpp>
+#include <sonotopy/SpectrumFrontEnd.hpp>
+#include <sonotopy/FFTPlanner.hpp>
 #include <sonotopy/Smoother.hpp>
 #include <sonotopy/Normalizer.hpp>
 #include <sonotopy/Stopwatch.hpp>
@@ -28,5 +30,6 @@
 #include <sonotopy/DisjointGridTopology.hpp>
 #include <sonotopy/EventDetector.hpp>
 #include <sonotopy/Random.hpp>
+#include <sonotopy/AudioBlockQueue.hpp>
 
 #endif
@@ -24,7 +24,9 @@ PerformanceTest::PerformanceTest(int _argc, char **_argv) {
   argv = _argv;
   audioInputFile = NULL;
   audioFileBuffer = NULL;
-  gridMapAudioInputBuffer = NULL;
+  audioInputBuffer = NULL;
+  gridMap = NULL;
+  spectrumFrontEnd = NULL;
 
   processCommandLineArguments();
   openAudioInputFile();
@@ -37,13 +39,16 @@ PerformanceTest::PerformanceTest(int _argc, char **_argv) {
 PerformanceTest::~PerformanceTest() {
   if(audioInputFile) sf_close(audioInputFile);
   if(audioFileBuffer) delete audioFileBuffer;
-  if(gridMapAudioInputBuffer) delete gridMapAudioInputBuffer;
+  if(audioInputBuffer) delete [] audioInputBuffer;
+  if(gridMap) delete gridMap;
+  if(spectrumFrontEnd) delete spectrumFrontEnd;
 }
 
 void PerformanceTest::processCommandLineArguments() {
   numTestTypes = 0;
   numIterations = 1;
   testSpectrumMap = false;
+  testSpectrumFrontEnd = false;
   audioInputFilename = NULL;
   int argnr = 1;
   char **argptr = argv + 1;
@@ -60,6 +65,13 @@ void PerformanceTest::processCommandLineArguments() {
         testSpectrumMap = true;
         numTestTypes++;
       }
+      else if(strcmp(argflag, "fe") == 0) {
+        testSpectrumFrontEnd = true;
+        numTestTypes++;
+      }
+      else if(strcmp(argflag, "sparse") == 0) {
+        spectrumAnalyzerParameters.sparseSpectrum = true;
+      }
       else if(strcmp(argflag, "n") == 0) {
         argnr++; argptr++;
         numIterations = atoi(*argptr);
@@ -93,6 +105,8 @@ void PerformanceTest::usage() {
   printf("Options:\n\n");
 
   printf(" -sm           Test spectrum map\n");
+  printf(" -fe           Test spectrum front end (analysis and bin division only)\n");
+  printf(" -sparse       Output only the spectrum positions used by the bins\n");
   printf(" -f <WAV file> Use audio file as input\n");
   printf(" -n <N>        Run N number of iterations\n");
 
@@ -117,25 +131,30 @@ void PerformanceTest::openAudioInputFile() {
 }
 
 void PerformanceTest::initializeAudioProcessing() {
-  if(testSpectrumMap) {
-    gridMap = new GridMap(audioParameters, gridMapParameters);
-    gridMapAudioInputBuffer = new float [audioParameters.bufferSize];
-  }
+  if(testSpectrumMap)
+    gridMap = new GridMap(audioParameters, spectrumAnalyzerParameters, gridMapParameters);
+  if(testSpectrumFrontEnd)
+    spectrumFrontEnd = new SpectrumFrontEnd(audioParameters, spectrumAnalyzerParameters);
+  audioInputBuffer = new float [audioParameters.bufferSize];
 }
 
 void PerformanceTest::processAudioBuffer() {
   float *inputPtr = audioFileBuffer;
-  float *gridMapAudioInputBufferPtr = gridMapAudioInputBuffer;
+  float *audioInputBufferPtr = audioInputBuffer;
 
   unsigned long i = 0;
   while(i < audioParameters.bufferSize) {
-    *gridMapAudioInputBufferPtr++ = *inputPtr;
+    *audioInputBufferPtr++ = *inputPtr;
     inputPtr += 2;
     i++;
   }
 
-  gridMap->feedAudio(gridMapAudioInputBuffer, audioParameters.bufferSize);
-  activationPattern = gridMap->getActivationPattern();
+  if(testSpectrumMap) {
+    gridMap->feedAudio(audioInputBuffer, audioParameters.bufferSize);
+    activationPattern = gridMap->getActivationPattern();
+  }
+  if(testSpectrumFrontEnd)
+    spectrumFrontEnd->feedAudio(audioInputBuffer, audioParameters.bufferSize);
 }
 
 void PerformanceTest::readAudioBufferFromFile() {
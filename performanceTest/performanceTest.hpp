@@ -42,11 +42,14 @@ private:
   int numTestTypes;
   int numIterations;
   bool testSpectrumMap;
+  bool testSpectrumFrontEnd;
   bool audioFileAtEnd;
   AudioParameters audioParameters;
+  SpectrumAnalyzerParameters spectrumAnalyzerParameters;
   GridMapParameters gridMapParameters;
   GridMap *gridMap;
-  float *gridMapAudioInputBuffer;
+  SpectrumFrontEnd *spectrumFrontEnd;
+  float *audioInputBuffer;
   SNDFILE *audioInputFile;
   float *audioFileBuffer;
   const SOM::ActivationPattern *activationPattern;
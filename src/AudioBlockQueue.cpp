@@ -0,0 +1,71 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "AudioBlockQueue.hpp"
+
+using namespace sonotopy;
+
+AudioBlockQueue::AudioBlockQueue(unsigned long _blockSize, unsigned long _numBlocks)
+  : buffer(_blockSize * _numBlocks) {
+  blockSize = _blockSize;
+  numBlocks = _numBlocks;
+  numPushedBlocks = 0;
+  numPoppedBlocks = 0;
+  numOverruns = 0;
+  numUnderruns = 0;
+}
+
+// The block counters only ever grow, each is written by one side alone, and
+// their difference is the number of queued blocks. Publishing a counter with
+// release and reading the other side's with acquire orders the block copies
+// against them.
+
+bool AudioBlockQueue::push(const float *block) {
+  unsigned long numPopped = __atomic_load_n(&numPoppedBlocks, __ATOMIC_ACQUIRE);
+  if(numPushedBlocks - numPopped == numBlocks) {
+    __atomic_add_fetch(&numOverruns, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  buffer.write(blockSize, block);
+  __atomic_store_n(&numPushedBlocks, numPushedBlocks + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool AudioBlockQueue::pop(float *block) {
+  unsigned long numPushed = __atomic_load_n(&numPushedBlocks, __ATOMIC_ACQUIRE);
+  if(numPushed == numPoppedBlocks) {
+    __atomic_add_fetch(&numUnderruns, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  buffer.read(blockSize, block);
+  buffer.moveReadHead(blockSize);
+  __atomic_store_n(&numPoppedBlocks, numPoppedBlocks + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+unsigned long AudioBlockQueue::getNumQueuedBlocks() const {
+  unsigned long numPopped = __atomic_load_n(&numPoppedBlocks, __ATOMIC_ACQUIRE);
+  unsigned long numPushed = __atomic_load_n(&numPushedBlocks, __ATOMIC_ACQUIRE);
+  return numPushed - numPopped;
+}
+
+unsigned long AudioBlockQueue::getNumOverruns() const {
+  return __atomic_load_n(&numOverruns, __ATOMIC_RELAXED);
+}
+
+unsigned long AudioBlockQueue::getNumUnderruns() const {
+  return __atomic_load_n(&numUnderruns, __ATOMIC_RELAXED);
+}
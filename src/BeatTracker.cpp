@@ -26,6 +26,20 @@ BeatTracker::BeatTracker(unsigned int _numFeatures, unsigned int _windowSize, un
   numFeatures = _numFeatures;
   windowSize = _windowSize;
   sampleRate = _sampleRate;
+  frontEnd = NULL;
+  initialize();
+}
+
+BeatTracker::BeatTracker(SpectrumFrontEnd *_frontEnd) {
+  frontEnd = _frontEnd;
+  numFeatures = frontEnd->getSpectrumBinDivider()->getNumBins();
+  windowSize = frontEnd->getAudioParameters().bufferSize;
+  sampleRate = frontEnd->getAudioParameters().sampleRate;
+  initialize();
+  frontEnd->attach(this);
+}
+
+void BeatTracker::initialize() {
   for(unsigned int i = 0; i < numFeatures; i++)
     previousFeatureVector.push_back(0);
   setAdaptationTimeMs(DEFAULT_ADAPTATION_TIME_MS);
@@ -33,6 +47,12 @@ BeatTracker::BeatTracker(unsigned int _numFeatures, unsigned int _windowSize, un
 }
 
 BeatTracker::~BeatTracker() {
+  if(frontEnd)
+    frontEnd->detach(this);
+}
+
+void BeatTracker::feedAnalysis(const SpectrumFrontEnd *analysis, unsigned long numFrames) {
+  feedFeatureVector(analysis->getBinValues());
 }
 
 void BeatTracker::setAdaptationTimeMs(float adaptationTimeMs) {
@@ -29,12 +29,25 @@ CircleMap::CircleMap(const AudioParameters &_audioParameters,
 {
 }
 
+CircleMap::CircleMap(SpectrumFrontEnd *frontEnd,
+		     const CircleMapParameters &_circleMapParameters)
+  : SpectrumMap(new CircleTopology(_circleMapParameters.numNodes),
+		frontEnd,
+		_circleMapParameters)
+{
+}
+
 float CircleMap::getAngle() {
   moveTopologyCursorTowardsWinner();
   return ((CircleTopology*)topology)->getCursorAngle();
 }
 
+void CircleMap::getCursorPosition(float &x, float &y) {
+  x = ((CircleTopology*)topology)->getCursorAngle();
+  y = 0;
+}
+
 void CircleMap::write(ofstream &f) const {
-  f << topology->getNumNodes() << endl;
+  f << topology->getNumNodes() << '\n';
   som->writeModelData(f);
 }
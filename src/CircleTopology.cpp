@@ -15,6 +15,7 @@
 
 #include "CircleTopology.hpp"
 #include <math.h>
+#include <stdlib.h>
 
 using namespace sonotopy;
 
@@ -44,6 +45,54 @@ float CircleTopology::getDistance(unsigned int sourceNodeId, unsigned int target
   return angularDistance / maxDistance;
 }
 
+// nodes are placed along x, and the distance of an offset is that from node 0
+bool CircleTopology::buildOffsetDistanceTable(OffsetDistanceTable &table) {
+  table.x.resize(numNodes);
+  table.y.assign(numNodes, 0);
+  for(unsigned int id = 0; id < numNodes; id++)
+    table.x[id] = id;
+  table.width = numNodes;
+  table.distances.resize(numNodes);
+  for(unsigned int offset = 0; offset < numNodes; offset++)
+    table.distances[offset] = getDistance(0, offset);
+  return true;
+}
+
+bool CircleTopology::buildStencil(Stencil &stencil) {
+  stencil.width = numNodes;
+  stencil.height = 1;
+  stencil.wrapAround = true;
+  if(vicinityFactor <= 0 || numNodes == 0)
+    return true;
+
+  // offsets from -(numNodes-1)/2 to numNodes/2 visit every node on the circle once
+  int minOffset = -(int) ((numNodes - 1) / 2);
+  int maxOffset = numNodes / 2;
+  float distance;
+  StencilRow row;
+  row.dy = 0;
+  for(int offset = minOffset; offset <= maxOffset; offset++) {
+    distance = (float) abs(offset) / numNodes * fullAngle / maxDistance;
+    if(distance < vicinityFactor) {
+      if(row.strengths.empty())
+        row.dxMin = offset;
+      row.strengths.push_back((vicinityFactor - distance) / vicinityFactor);
+    }
+    else if(offset > 0) {
+      break;
+    }
+  }
+  stencil.rows.push_back(row);
+  return true;
+}
+
+void CircleTopology::findAdjacentNodes(unsigned int nodeId, std::vector<unsigned int> &nodes) {
+  nodes.clear();
+  nodes.push_back((nodeId + numNodes - 1) % numNodes);
+  if(numNodes > 2)
+    nodes.push_back((nodeId + 1) % numNodes);
+}
+
 CircleTopology::Node CircleTopology::getNode(unsigned int nodeId) {
   return nodes[nodeId];
 }
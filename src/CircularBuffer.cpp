@@ -39,10 +39,23 @@ CircularBuffer<T>::~CircularBuffer() {
 
 template <class T>
 void CircularBuffer<T>::write(unsigned long numItems, const T *items) {
-  T *readPtr1 = (T *) items;
-  for(unsigned long i = 0; i < numItems; i++) {
-    write(*readPtr1++);
+  // copied in at most two chunks; only the last size items survive
+  if(numItems > size) {
+    items += numItems - size;
+    writePos = (writePos + numItems - size) % size;
+    numItems = size;
   }
+  unsigned long numItemsToEnd = size - writePos;
+  if(numItems < numItemsToEnd) {
+    memcpy(buffer + writePos, items, sizeof(T) * numItems);
+    writePos += numItems;
+  }
+  else {
+    memcpy(buffer + writePos, items, sizeof(T) * numItemsToEnd);
+    memcpy(buffer, items + numItemsToEnd, sizeof(T) * (numItems - numItemsToEnd));
+    writePos = numItems - numItemsToEnd;
+  }
+  writePtr = buffer + writePos;
 }
 
 template <class T>
@@ -57,16 +70,14 @@ void CircularBuffer<T>::write(const T item) {
 
 template <class T>
 void CircularBuffer<T>::read(unsigned long numItems, T *dest) {
-  T *destPtr = dest;
-  T *readPtr1 = readPtr;
-  unsigned long readPos1 = readPos;
-  for(unsigned long i = 0; i < numItems; i++) {
-    *destPtr++ = *readPtr1++;
-    readPos1++;
-    if(readPos1 == size) {
-      readPos1 = 0;
-      readPtr1 = buffer;
-    }
+  // numItems may exceed size, in which case the buffer is read repeatedly
+  unsigned long pos = readPos;
+  while(numItems > 0) {
+    unsigned long chunkSize = size - pos < numItems ? size - pos : numItems;
+    memcpy(dest, buffer + pos, sizeof(T) * chunkSize);
+    dest += chunkSize;
+    numItems -= chunkSize;
+    pos = 0;
   }
 }
 
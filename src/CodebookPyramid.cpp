@@ -0,0 +1,176 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "CodebookPyramid.hpp"
+#include <algorithm>
+
+using namespace sonotopy;
+using namespace std;
+
+// the coarsest level is searched exhaustively, so it is kept this small
+#define MAX_CELLS_IN_TOP_LEVEL 16
+
+CodebookPyramid::CodebookPyramid(unsigned int _gridWidth, unsigned int _gridHeight, unsigned int _stride) {
+  gridWidth = _gridWidth;
+  gridHeight = _gridHeight;
+  stride = _stride;
+  unsigned int width = gridWidth;
+  unsigned int height = gridHeight;
+  while(width * height > MAX_CELLS_IN_TOP_LEVEL) {
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+    Level level;
+    level.width = width;
+    level.height = height;
+    level.values.resize(width * height * stride);
+    level.dirty.resize(width * height, 0);
+    levels.push_back(level);
+  }
+  allDirty = true;
+}
+
+void CodebookPyramid::invalidate() {
+  allDirty = true;
+}
+
+void CodebookPyramid::invalidate(unsigned int xMin, unsigned int yMin, unsigned int xMax, unsigned int yMax) {
+  if(allDirty || levels.empty())
+    return;
+  Level &level = levels[0];
+  for(unsigned int y = yMin / 2; y <= yMax / 2; y++)
+    for(unsigned int x = xMin / 2; x <= xMax / 2; x++)
+      markDirty(level, x, y);
+}
+
+void CodebookPyramid::markDirty(Level &level, unsigned int x, unsigned int y) {
+  unsigned int cell = y * level.width + x;
+  if(!level.dirty[cell]) {
+    level.dirty[cell] = 1;
+    level.dirtyCells.push_back(cell);
+  }
+}
+
+void CodebookPyramid::update(const float *models) {
+  unsigned int numLevels = levels.size();
+  for(unsigned int l = 0; l < numLevels; l++) {
+    Level &level = levels[l];
+    if(allDirty) {
+      for(unsigned int y = 0; y < level.height; y++)
+	for(unsigned int x = 0; x < level.width; x++)
+	  updateCell(l, x, y, models);
+      // cells flagged before the full invalidation must be flaggable again
+      for(vector<unsigned int>::const_iterator i = level.dirtyCells.begin(); i != level.dirtyCells.end(); ++i)
+	level.dirty[*i] = 0;
+    }
+    else {
+      for(vector<unsigned int>::const_iterator i = level.dirtyCells.begin(); i != level.dirtyCells.end(); ++i) {
+	unsigned int y = *i / level.width;
+	unsigned int x = *i - y * level.width;
+	updateCell(l, x, y, models);
+	level.dirty[*i] = 0;
+	if(l + 1 < numLevels)
+	  markDirty(levels[l + 1], x / 2, y / 2);
+      }
+    }
+    level.dirtyCells.clear();
+  }
+  allDirty = false;
+}
+
+void CodebookPyramid::updateCell(unsigned int levelIndex, unsigned int x, unsigned int y, const float *models) {
+  const float *finer;
+  unsigned int finerWidth, finerHeight;
+  if(levelIndex == 0) {
+    finer = models;
+    finerWidth = gridWidth;
+    finerHeight = gridHeight;
+  }
+  else {
+    const Level &finerLevel = levels[levelIndex - 1];
+    finer = &finerLevel.values[0];
+    finerWidth = finerLevel.width;
+    finerHeight = finerLevel.height;
+  }
+
+  Level &level = levels[levelIndex];
+  float *values = &level.values[(y * level.width + x) * stride];
+  unsigned int xEnd = min(x * 2 + 2, finerWidth);
+  unsigned int yEnd = min(y * 2 + 2, finerHeight);
+  unsigned int numChildren = (xEnd - x * 2) * (yEnd - y * 2);
+  float scale = 1.0f / numChildren;
+  fill(values, values + stride, 0.0f);
+  for(unsigned int fy = y * 2; fy < yEnd; fy++) {
+    for(unsigned int fx = x * 2; fx < xEnd; fx++) {
+      const float *child = finer + (fy * finerWidth + fx) * stride;
+      for(unsigned int k = 0; k < stride; k++)
+	values[k] += child[k];
+    }
+  }
+  for(unsigned int k = 0; k < stride; k++)
+    values[k] *= scale;
+}
+
+unsigned int CodebookPyramid::search(const float *models, const float *input, unsigned int beamWidth,
+				     SOMKernels::SquaredDistanceFunction squaredDistance, float &distance) {
+  update(models);
+  if(beamWidth < 1)
+    beamWidth = 1;
+
+  // start with every cell of the coarsest level, or every model if there is no coarser level
+  Candidate candidate;
+  candidates.clear();
+  unsigned int topWidth = levels.empty() ? gridWidth : levels.back().width;
+  unsigned int topHeight = levels.empty() ? gridHeight : levels.back().height;
+  const float *topValues = levels.empty() ? models : &levels.back().values[0];
+  for(candidate.y = 0; candidate.y < topHeight; candidate.y++) {
+    for(candidate.x = 0; candidate.x < topWidth; candidate.x++) {
+      candidate.distance = squaredDistance(topValues + (candidate.y * topWidth + candidate.x) * stride,
+					   input, stride);
+      candidates.push_back(candidate);
+    }
+  }
+
+  // refine the best cells level by level; level -1 denotes the models
+  for(int l = (int) levels.size() - 2; l >= -1; l--) {
+    unsigned int numBeam = min(beamWidth, (unsigned int) candidates.size());
+    partial_sort(candidates.begin(), candidates.begin() + numBeam, candidates.end(), compareCandidates);
+    beam.assign(candidates.begin(), candidates.begin() + numBeam);
+
+    unsigned int width = l >= 0 ? levels[l].width : gridWidth;
+    unsigned int height = l >= 0 ? levels[l].height : gridHeight;
+    const float *values = l >= 0 ? &levels[l].values[0] : models;
+    candidates.clear();
+    for(vector<Candidate>::const_iterator i = beam.begin(); i != beam.end(); ++i) {
+      unsigned int xEnd = min(i->x * 2 + 2, width);
+      unsigned int yEnd = min(i->y * 2 + 2, height);
+      for(candidate.y = i->y * 2; candidate.y < yEnd; candidate.y++) {
+	for(candidate.x = i->x * 2; candidate.x < xEnd; candidate.x++) {
+	  candidate.distance = squaredDistance(values + (candidate.y * width + candidate.x) * stride,
+					       input, stride);
+	  candidates.push_back(candidate);
+	}
+      }
+    }
+  }
+
+  vector<Candidate>::const_iterator winner = min_element(candidates.begin(), candidates.end(), compareCandidates);
+  distance = winner->distance;
+  return winner->y * gridWidth + winner->x;
+}
+
+bool CodebookPyramid::compareCandidates(const Candidate &a, const Candidate &b) {
+  return a.distance < b.distance;
+}
@@ -0,0 +1,171 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "CompressedCodebook.hpp"
+#include <math.h>
+
+using namespace sonotopy;
+using namespace std;
+
+CompressedCodebook::CompressedCodebook(const SOM *_som, Precision _precision) {
+  som = _som;
+  precision = _precision;
+  inputSize = som->getInputSize();
+  numModels = som->getNumModels();
+  stride = som->getModelStride(); // rows line up with the SOM's, so kernels run on whole vectors
+  setInstructionSet(som->getInstructionSet());
+  update();
+}
+
+void CompressedCodebook::setInstructionSet(SOMKernels::InstructionSet instructionSet) {
+  halfSquaredDistanceKernel = SOMKernels::getHalfSquaredDistanceFunction(instructionSet);
+  byteSquaredDistanceKernel = SOMKernels::getByteSquaredDistanceFunction(instructionSet);
+}
+
+void CompressedCodebook::update() {
+  if(precision == Half) {
+    halfModels.assign(numModels * stride, 0);
+    for(unsigned int modelId = 0; modelId < numModels; modelId++) {
+      const float *model = som->getModel(modelId);
+      unsigned short *halfModel = &halfModels[modelId * stride];
+      for(unsigned int k = 0; k < inputSize; k++)
+	halfModel[k] = SOMKernels::floatToHalf(model[k]);
+    }
+    return;
+  }
+
+  offsets.assign(stride, 0);
+  scales.assign(stride, 0);
+  for(unsigned int k = 0; k < inputSize; k++) {
+    float min = som->getModel(0)[k];
+    float max = min;
+    for(unsigned int modelId = 1; modelId < numModels; modelId++) {
+      float value = som->getModel(modelId)[k];
+      if(value < min)
+	min = value;
+      else if(value > max)
+	max = value;
+    }
+    offsets[k] = min;
+    scales[k] = (max - min) / 255;
+  }
+
+  byteModels.assign(numModels * stride, 0);
+  for(unsigned int modelId = 0; modelId < numModels; modelId++) {
+    const float *model = som->getModel(modelId);
+    unsigned char *byteModel = &byteModels[modelId * stride];
+    for(unsigned int k = 0; k < inputSize; k++) {
+      if(scales[k] > 0) {
+	float q = floorf((model[k] - offsets[k]) / scales[k] + 0.5f);
+	byteModel[k] = (unsigned char) (q < 0 ? 0 : (q > 255 ? 255 : q));
+      }
+    }
+  }
+}
+
+size_t CompressedCodebook::getNumBytes() const {
+  if(precision == Half)
+    return halfModels.size() * sizeof(unsigned short);
+  return byteModels.size() + (offsets.size() + scales.size()) * sizeof(float);
+}
+
+float CompressedCodebook::getModelValue(unsigned int modelId, unsigned int k) const {
+  if(precision == Half)
+    return SOMKernels::halfToFloat(halfModels[modelId * stride + k]);
+  return offsets[k] + scales[k] * byteModels[modelId * stride + k];
+}
+
+unsigned int CompressedCodebook::getWinner(const SOM::Sample &input) const {
+  float distance;
+  float closest = 0;
+  unsigned int winner = 0;
+  vector<float> query(stride, 0); // padded (and for bytes, shifted) input, per call for concurrent readers
+  if(precision == Half) {
+    for(unsigned int k = 0; k < inputSize; k++)
+      query[k] = input[k];
+    const unsigned short *model = &halfModels[0];
+    for(unsigned int modelId = 0; modelId < numModels; modelId++) {
+      distance = halfSquaredDistanceKernel(model, &query[0], stride);
+      if(modelId == 0 || distance < closest) {
+	closest = distance;
+	winner = modelId;
+      }
+      model += stride;
+    }
+  }
+  else {
+    for(unsigned int k = 0; k < inputSize; k++)
+      query[k] = input[k] - offsets[k];
+    const unsigned char *model = &byteModels[0];
+    for(unsigned int modelId = 0; modelId < numModels; modelId++) {
+      distance = byteSquaredDistanceKernel(model, &scales[0], &query[0], stride);
+      if(modelId == 0 || distance < closest) {
+	closest = distance;
+	winner = modelId;
+      }
+      model += stride;
+    }
+  }
+  return winner;
+}
+
+CompressedCodebook::AccuracyReport CompressedCodebook::getAccuracy(const vector<SOM::Sample> &inputs) const {
+  AccuracyReport report;
+  report.numInputs = inputs.size();
+  report.numMatchingWinners = 0;
+  report.meanOutputIncrease = 0;
+  report.maxModelError = 0;
+
+  float error;
+  for(unsigned int modelId = 0; modelId < numModels; modelId++) {
+    const float *model = som->getModel(modelId);
+    for(unsigned int k = 0; k < inputSize; k++) {
+      error = fabsf(getModelValue(modelId, k) - model[k]);
+      if(error > report.maxModelError)
+	report.maxModelError = error;
+    }
+  }
+
+  // full precision distances are computed here rather than by the SOM, whose output state must not change
+  SOMKernels::SquaredDistanceFunction squaredDistance =
+    SOMKernels::getSquaredDistanceFunction(som->getInstructionSet());
+  float maxDistance = sqrtf((float) inputSize);
+  float distance, closest;
+  for(vector<SOM::Sample>::const_iterator input = inputs.begin(); input != inputs.end(); ++input) {
+    unsigned int winner = getWinner(*input);
+    unsigned int trueWinner = 0;
+    closest = 0;
+    for(unsigned int modelId = 0; modelId < numModels; modelId++) {
+      distance = squaredDistance(som->getModel(modelId), &(*input)[0], inputSize);
+      if(modelId == 0 || distance < closest) {
+	closest = distance;
+	trueWinner = modelId;
+      }
+    }
+    if(winner == trueWinner)
+      report.numMatchingWinners++;
+    distance = squaredDistance(som->getModel(winner), &(*input)[0], inputSize);
+    report.meanOutputIncrease += (sqrtf(distance) - sqrtf(closest)) / maxDistance;
+  }
+  if(report.numInputs > 0) {
+    report.winnerAgreement = (float) report.numMatchingWinners / report.numInputs;
+    report.meanOutputIncrease /= report.numInputs;
+  }
+  else {
+    report.winnerAgreement = 0;
+  }
+  return report;
+}
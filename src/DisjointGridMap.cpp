@@ -29,8 +29,24 @@ DisjointGridMap::DisjointGridMap(const AudioParameters &_audioParameters,
 				     _gridMapParameters.gridHeight,
 				     nodes))
 {
-  for(int y = 0; y < _gridMapParameters.gridHeight; y++)
-    for(int x = 0; x < _gridMapParameters.gridWidth; x++)
+  createRectActivationPattern();
+}
+
+DisjointGridMap::DisjointGridMap(SpectrumFrontEnd *frontEnd,
+				 const GridMapParameters &_gridMapParameters,
+				 const vector<DisjointGridTopology::Node> &nodes)
+  : GridMap(frontEnd,
+	    _gridMapParameters,
+	    new DisjointGridTopology(_gridMapParameters.gridWidth,
+				     _gridMapParameters.gridHeight,
+				     nodes))
+{
+  createRectActivationPattern();
+}
+
+void DisjointGridMap::createRectActivationPattern() {
+  for(int y = 0; y < gridMapParameters.gridHeight; y++)
+    for(int x = 0; x < gridMapParameters.gridWidth; x++)
       rectActivationPattern.push_back(0);
 }
 
@@ -42,11 +42,33 @@ unsigned int DisjointGridTopology::getNumNodes() {
 float DisjointGridTopology::getDistance(unsigned int sourceNodeId, unsigned int targetNodeId) {
   Node sourceNode = getNode(sourceNodeId);
   Node targetNode = getNode(targetNodeId);
-  int dx = sourceNode.x - targetNode.x;
-  int dy = sourceNode.y - targetNode.y;
+  return offsetToDistance(sourceNode.x - targetNode.x, sourceNode.y - targetNode.y);
+}
+
+float DisjointGridTopology::offsetToDistance(int dx, int dy) const {
   return (float) (dx*dx + dy*dy) / maxDistance;
 }
 
+bool DisjointGridTopology::buildOffsetDistanceTable(OffsetDistanceTable &table) {
+  unsigned int width = 1, height = 1;
+  table.x.resize(numNodes);
+  table.y.resize(numNodes);
+  for(unsigned int id = 0; id < numNodes; id++) {
+    table.x[id] = nodes[id].x;
+    table.y[id] = nodes[id].y;
+    if(nodes[id].x >= width)
+      width = nodes[id].x + 1;
+    if(nodes[id].y >= height)
+      height = nodes[id].y + 1;
+  }
+  table.width = width;
+  table.distances.resize(width * height);
+  for(int dy = 0; dy < (int) height; dy++)
+    for(int dx = 0; dx < (int) width; dx++)
+      table.distances[dy * width + dx] = offsetToDistance(dx, dy);
+  return true;
+}
+
 void DisjointGridTopology::idToGridCoordinates(unsigned int id, unsigned int &x, unsigned int &y) {
   x = nodes[id].x;
   y = nodes[id].y;
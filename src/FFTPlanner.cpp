@@ -0,0 +1,100 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "FFTPlanner.hpp"
+#include <pthread.h>
+#include <stdio.h>
+#include <map>
+
+using namespace sonotopy;
+using namespace std;
+
+// statically initialized, so that analyzers can be created before main
+static pthread_mutex_t plannerMutex = PTHREAD_MUTEX_INITIALIZER;
+static map<int, fftwf_plan> *realPlans = NULL;
+static string *wisdomFile = NULL;
+
+void FFTPlanner::lock() {
+  pthread_mutex_lock(&plannerMutex);
+  if(!realPlans) {
+    realPlans = new map<int, fftwf_plan>;
+    wisdomFile = new string;
+  }
+}
+
+void FFTPlanner::unlock() {
+  pthread_mutex_unlock(&plannerMutex);
+}
+
+fftwf_plan FFTPlanner::getRealPlan(int size) {
+  lock();
+  map<int, fftwf_plan>::iterator i = realPlans->find(size);
+  if(i != realPlans->end()) {
+    fftwf_plan plan = i->second;
+    unlock();
+    return plan;
+  }
+
+  // measuring overwrites the arrays, so the plan is made on scratch buffers
+  // of the same alignment as the ones it will be executed on
+  float *in = fftwf_alloc_real(size);
+  fftwf_complex *out = fftwf_alloc_complex(size / 2 + 1);
+  fftwf_plan plan = fftwf_plan_dft_r2c_1d(size, in, out, FFTW_MEASURE);
+  fftwf_free(in);
+  fftwf_free(out);
+  (*realPlans)[size] = plan;
+  if(!wisdomFile->empty())
+    fftwf_export_wisdom_to_filename(wisdomFile->c_str());
+  unlock();
+  return plan;
+}
+
+bool FFTPlanner::setWisdomFile(const string &filename) {
+  bool imported = true;
+  lock();
+  *wisdomFile = filename;
+  if(!filename.empty()) {
+    FILE *f = fopen(filename.c_str(), "r");
+    if(f) {
+      fclose(f);
+      imported = fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+    }
+  }
+  unlock();
+  return imported;
+}
+
+string FFTPlanner::getWisdomFile() {
+  lock();
+  string filename = *wisdomFile;
+  unlock();
+  return filename;
+}
+
+bool FFTPlanner::saveWisdom() {
+  lock();
+  bool saved = !wisdomFile->empty()
+    && fftwf_export_wisdom_to_filename(wisdomFile->c_str()) != 0;
+  unlock();
+  return saved;
+}
+
+unsigned int FFTPlanner::getNumPlans() {
+  lock();
+  unsigned int numPlans = realPlans->size();
+  unlock();
+  return numPlans;
+}
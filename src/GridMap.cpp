@@ -43,6 +43,26 @@ GridMap::GridMap(const AudioParameters &_audioParameters,
   gridMapParameters = _gridMapParameters;
 }
 
+GridMap::GridMap(SpectrumFrontEnd *frontEnd,
+		 const GridMapParameters &_gridMapParameters)
+  : SpectrumMap(new RectGridTopology(_gridMapParameters.gridWidth,
+				     _gridMapParameters.gridHeight),
+		frontEnd,
+		_gridMapParameters)
+{
+  gridMapParameters = _gridMapParameters;
+}
+
+GridMap::GridMap(SpectrumFrontEnd *frontEnd,
+		 const GridMapParameters &_gridMapParameters,
+		 Topology *topology)
+  : SpectrumMap(topology,
+		frontEnd,
+		_gridMapParameters)
+{
+  gridMapParameters = _gridMapParameters;
+}
+
 float GridMap::getActivation(unsigned int x, unsigned int y) {
   unsigned int nodeId = ((RectGridTopology*) topology)->gridCoordinatesToId(x, y);
   getActivationPattern();
@@ -55,8 +75,12 @@ const float* GridMap::getModel(unsigned int x, unsigned int y) const {
 }
 
 void GridMap::getCursor(float &x, float &y) {
-  static float gridX, gridY;
   moveTopologyCursorTowardsWinner();
+  getCursorPosition(x, y);
+}
+
+void GridMap::getCursorPosition(float &x, float &y) {
+  float gridX, gridY;
   ((RectGridTopology*) topology)->getCursorPosition(gridX, gridY);
   x = (gridX + 0.5) / gridMapParameters.gridWidth;
   y = (gridY + 0.5) / gridMapParameters.gridHeight;
@@ -67,7 +91,7 @@ const GridMapParameters GridMap::getParameters() const {
 }
 
 void GridMap::write(ofstream &f) const {
-  f << gridMapParameters.gridWidth << endl;
-  f << gridMapParameters.gridHeight << endl;
+  f << gridMapParameters.gridWidth << '\n';
+  f << gridMapParameters.gridHeight << '\n';
   som->writeModelData(f);
 }
@@ -0,0 +1,128 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "MirroredCircularBuffer.hpp"
+#include <string.h>
+#include <assert.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef MFD_CLOEXEC
+#define SONOTOPY_MIRRORED_MAPPING
+#endif
+#endif
+
+using namespace sonotopy;
+
+template <class T>
+MirroredCircularBuffer<T>::MirroredCircularBuffer(unsigned long _size) {
+  size = _size;
+  writePos = 0;
+  readPos = 0;
+  mapped = map();
+  if(!mapped) {
+    buffer = new T[2 * size];
+    memset(buffer, 0, sizeof(T) * 2 * size);
+  }
+}
+
+template <class T>
+MirroredCircularBuffer<T>::~MirroredCircularBuffer() {
+#ifdef SONOTOPY_MIRRORED_MAPPING
+  if(mapped) {
+    munmap(buffer, 2 * sizeof(T) * size);
+    return;
+  }
+#endif
+  delete [] buffer;
+}
+
+// maps one shared memory file twice, back to back, into a reserved range
+template <class T>
+bool MirroredCircularBuffer<T>::map() {
+#ifdef SONOTOPY_MIRRORED_MAPPING
+  size_t numBytes = sizeof(T) * size;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if(size == 0 || pageSize <= 0 || numBytes % pageSize != 0)
+    return false;
+  int fd = memfd_create("sonotopy-circular-buffer", MFD_CLOEXEC);
+  if(fd < 0)
+    return false;
+  if(ftruncate(fd, numBytes) != 0) {
+    close(fd);
+    return false;
+  }
+  char *region = (char *) mmap(NULL, 2 * numBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(region == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  bool success =
+    mmap(region, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED
+    && mmap(region + numBytes, numBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != MAP_FAILED;
+  close(fd);
+  if(!success) {
+    munmap(region, 2 * numBytes);
+    return false;
+  }
+  buffer = (T *) region; // a new memory file is zero-filled
+  return true;
+#else
+  return false;
+#endif
+}
+
+template <class T>
+void MirroredCircularBuffer<T>::write(unsigned long numItems, const T *items) {
+  // only the last size items survive
+  if(numItems > size) {
+    items += numItems - size;
+    writePos = (writePos + numItems - size) % size;
+    numItems = size;
+  }
+  unsigned long numItemsToEnd = size - writePos;
+  if(numItems <= numItemsToEnd) {
+    writeChunk(writePos, numItems, items);
+  }
+  else {
+    writeChunk(writePos, numItemsToEnd, items);
+    writeChunk(0, numItems - numItemsToEnd, items + numItemsToEnd);
+  }
+  writePos = (writePos + numItems) % size;
+}
+
+template <class T>
+void MirroredCircularBuffer<T>::writeChunk(unsigned long pos, unsigned long numItems, const T *items) {
+  memcpy(buffer + pos, items, sizeof(T) * numItems);
+  if(!mapped)
+    memcpy(buffer + size + pos, items, sizeof(T) * numItems);
+}
+
+template <class T>
+void MirroredCircularBuffer<T>::read(unsigned long numItems, T *dest) const {
+  assert(numItems <= size); // the mirror only spans one buffer length
+  memcpy(dest, buffer + readPos, sizeof(T) * numItems);
+}
+
+template <class T>
+void MirroredCircularBuffer<T>::moveReadHead(unsigned long x) {
+  readPos = (readPos + x) % size;
+}
+
+template class sonotopy::MirroredCircularBuffer<float>;
+template class sonotopy::MirroredCircularBuffer<double>;
+template class sonotopy::MirroredCircularBuffer<int>;
@@ -0,0 +1,40 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "ModelPublisher.hpp"
+#include <string.h>
+
+using namespace sonotopy;
+
+ModelPublisher::ModelPublisher(unsigned int numModels, unsigned int stride, unsigned int numBuffers)
+  : publisher(numBuffers) {
+  for(unsigned int i = 0; i < publisher.getNumBuffers(); i++) {
+    Snapshot &snapshot = publisher.getBuffer(i);
+    snapshot.data.resize(numModels * stride);
+    snapshot.stride = stride;
+    snapshot.version = 0;
+  }
+}
+
+bool ModelPublisher::publish(const float *modelData, unsigned long version) {
+  Snapshot *snapshot = publisher.beginPublication();
+  if(!snapshot)
+    return false;
+  memcpy(&snapshot->data[0], modelData, sizeof(float) * snapshot->data.size());
+  snapshot->version = version;
+  publisher.endPublication();
+  return true;
+}
@@ -43,6 +43,67 @@ float RectGridTopology::getDistance(unsigned int sourceNodeId, unsigned int targ
   return (float) (dx*dx + dy*dy) / maxDistance;
 }
 
+bool RectGridTopology::buildOffsetDistanceTable(OffsetDistanceTable &table) {
+  table.x.resize(numNodes);
+  table.y.resize(numNodes);
+  for(unsigned int id = 0; id < numNodes; id++) {
+    table.x[id] = id % gridWidth;
+    table.y[id] = id / gridWidth;
+  }
+  table.width = gridWidth;
+  table.distances.resize(numNodes);
+  for(int dy = 0; dy < (int) gridHeight; dy++)
+    for(int dx = 0; dx < (int) gridWidth; dx++)
+      table.distances[dy * gridWidth + dx] = getDistance(0, gridCoordinatesToId(dx, dy));
+  return true;
+}
+
+bool RectGridTopology::buildStencil(Stencil &stencil) {
+  stencil.width = gridWidth;
+  stencil.height = gridHeight;
+  stencil.wrapAround = false;
+  if(vicinityFactor <= 0)
+    return true;
+
+  // same distance and strength arithmetic as getDistance and Topology::findNeighbours
+  int maxDx = gridWidth - 1;
+  int maxDy = gridHeight - 1;
+  float distance;
+  StencilRow row;
+  for(int dy = -maxDy; dy <= maxDy; dy++) {
+    row.dy = dy;
+    row.strengths.clear();
+    for(int dx = -maxDx; dx <= maxDx; dx++) {
+      distance = (float) (dx*dx + dy*dy) / maxDistance;
+      if(distance < vicinityFactor) {
+        if(row.strengths.empty())
+          row.dxMin = dx;
+        row.strengths.push_back((float) (vicinityFactor - distance) / vicinityFactor);
+      }
+      else if(dx > 0) {
+        break;
+      }
+    }
+    if(!row.strengths.empty())
+      stencil.rows.push_back(row);
+  }
+  return true;
+}
+
+void RectGridTopology::findAdjacentNodes(unsigned int nodeId, std::vector<unsigned int> &nodes) {
+  Node node = getNode(nodeId);
+  int x, y;
+  nodes.clear();
+  for(int dy = -1; dy <= 1; dy++) {
+    for(int dx = -1; dx <= 1; dx++) {
+      x = node.x + dx;
+      y = node.y + dy;
+      if((dx != 0 || dy != 0) && x >= 0 && x < (int) gridWidth && y >= 0 && y < (int) gridHeight)
+        nodes.push_back(gridCoordinatesToId(x, y));
+    }
+  }
+}
+
 void RectGridTopology::idToGridCoordinates(unsigned int id, unsigned int &x, unsigned int &y) {
   y = id / gridWidth;
   x = id - y * gridWidth;
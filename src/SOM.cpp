@@ -15,12 +15,122 @@
 
 #include "SOM.hpp"
 #include "Random.hpp"
+#include "CodebookPyramid.hpp"
+#include "RectGridTopology.hpp"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 #include <cassert>
+#include <stdexcept>
 
 using namespace sonotopy;
 using namespace std;
 
+#define CACHE_LINE_SIZE 64
+#define FLOATS_PER_CACHE_LINE (CACHE_LINE_SIZE / sizeof(float))
+
+// below these sizes, splitting work across threads costs more than it saves
+#define MIN_MODELS_PER_SEARCH_CHUNK 256
+#define MIN_NEIGHBOURS_PER_UPDATE_CHUNK 64
+#define MIN_STENCIL_ROWS_PER_UPDATE_CHUNK 4
+#define MIN_MODELS_PER_INITIALIZATION_CHUNK 64
+
+// number of models compared to every sample of a batch before moving on,
+// so that the block stays in cache while the batch is swept
+#define MODELS_PER_BATCH_BLOCK 64
+
+static float *allocateAligned(size_t numFloats, void **allocation) {
+  *allocation = malloc(sizeof(float) * numFloats + CACHE_LINE_SIZE);
+  float *data = (float *) (((size_t) *allocation + CACHE_LINE_SIZE - 1)
+			   & ~((size_t) CACHE_LINE_SIZE - 1));
+  memset(data, 0, sizeof(float) * numFloats);
+  return data;
+}
+
+// a zero-padded, cache line aligned copy of a sample for the const queries,
+// which must not write to the input row shared with training
+class PaddedSample {
+public:
+  PaddedSample(const float *sample, unsigned int size, unsigned int stride) {
+    values = allocateAligned(stride, &allocation);
+    memcpy(values, sample, sizeof(float) * size);
+  }
+  ~PaddedSample() { free(allocation); }
+  const float *getValues() const { return values; }
+private:
+  PaddedSample(const PaddedSample &);
+  PaddedSample &operator=(const PaddedSample &);
+  float *values;
+  void *allocation;
+};
+
+class SOM::WinnerSearchTask : public ThreadPool::Task {
+public:
+  WinnerSearchTask(const SOM *_som, const float *_input, float *_squaredDistances, uint numChunks)
+    : som(_som), input(_input), squaredDistances(_squaredDistances), results(numChunks) {}
+  void run(unsigned int chunk, unsigned int begin, unsigned int end) {
+    som->searchWinner(input, begin, end, squaredDistances, results[chunk]);
+  }
+  const SOM *som;
+  const float *input;
+  float *squaredDistances;
+  std::vector<SearchResult> results;
+};
+
+class SOM::NeighbourUpdateTask : public ThreadPool::Task {
+public:
+  NeighbourUpdateTask(SOM *_som, const std::vector<Topology::Neighbour> &_neighbours, const float *_input)
+    : som(_som), neighbours(_neighbours), input(_input) {}
+  void run(unsigned int chunk, unsigned int begin, unsigned int end) {
+    float learningParameter = som->learningParameter;
+    for(unsigned int i = begin; i < end; i++)
+      som->models[neighbours[i].nodeId].moveTowards(input, learningParameter * (float) neighbours[i].strength);
+  }
+  SOM *som;
+  const std::vector<Topology::Neighbour> &neighbours;
+  const float *input;
+};
+
+class SOM::StencilUpdateTask : public ThreadPool::Task {
+public:
+  StencilUpdateTask(SOM *_som, const Topology::Stencil &_stencil, uint _centreId, const float *_input)
+    : som(_som), stencil(_stencil), centreId(_centreId), input(_input) {}
+  void run(unsigned int chunk, unsigned int begin, unsigned int end) {
+    som->applyStencil(stencil, centreId, input, begin, end);
+  }
+  SOM *som;
+  const Topology::Stencil &stencil;
+  uint centreId;
+  const float *input;
+};
+
+class SOM::BatchSearchTask : public ThreadPool::Task {
+public:
+  BatchSearchTask(const SOM *_som, uint _numSamples, float *_lastSquaredDistances, uint numChunks)
+    : som(_som), numSamples(_numSamples), lastSquaredDistances(_lastSquaredDistances),
+      results(numChunks * _numSamples) {}
+  void run(unsigned int chunk, unsigned int begin, unsigned int end) {
+    som->searchWinnersInBatch(numSamples, begin, end, &results[chunk * numSamples], lastSquaredDistances);
+  }
+  const SOM *som;
+  uint numSamples;
+  float *lastSquaredDistances;
+  std::vector<SearchResult> results;
+};
+
+class SOM::ModelInitializationTask : public ThreadPool::Task {
+public:
+  ModelInitializationTask(SOM *_som, uint64_t _firstCounter, float _min, float _max)
+    : som(_som), firstCounter(_firstCounter), min(_min), max(_max) {}
+  void run(unsigned int chunk, unsigned int begin, unsigned int end) {
+    for(unsigned int i = begin; i < end; i++)
+      som->models[i].setRandomValues(som->randomStream, firstCounter + (uint64_t) i * som->inputSize, min, max);
+  }
+  SOM *som;
+  uint64_t firstCounter;
+  float min, max;
+};
+
 SOM::SOM(uint _inputSize, Topology *_topology) {
   assert(_inputSize != 0);
   inputSize = _inputSize;
@@ -29,11 +139,31 @@ SOM::SOM(uint _inputSize, Topology *_topology) {
   setLearningParameter(0.5);
   outputMin = 0;
   outputMax = 0;
+  outputsOutdated = false;
   maxDistance = ::sqrt((float)inputSize); // sqrt(1 + 1 ... inputSize times)
+  setInstructionSet(SOMKernels::getBestInstructionSet());
+  threadPool = NULL;
+  batchData = NULL;
+  batchDataAllocation = NULL;
+  batchCapacity = 0;
+  lastWinnerId = 0;
+  numLocalSearches = 0;
+  numFullSearches = 0;
+  setLocalSearch(false);
+  pyramid = NULL;
+  gridTopology = NULL;
+  modelPublisher = NULL;
+  numTrainings = 0;
+  dirtyTracking = false;
+  randomSeedSet = false;
+  numRandomInitializations = 0;
   createModels();
 }
 
 SOM::~SOM() {
+  delete threadPool;
+  delete pyramid;
+  delete modelPublisher;
   deleteModels();
 }
 
@@ -42,13 +172,54 @@ Topology *SOM::getTopology() const {
 }
 
 void SOM::createModels() {
+  modelStride = getPaddedSize(inputSize);
+  modelData = allocateAligned(modelStride * (numModels + 1), &modelDataAllocation);
+  paddedInput = modelData + numModels * modelStride;
+
+  models.reserve(numModels);
   for(uint id = 0; id < numModels; id++)
-    models.push_back(new Model(this, id));
+    models.push_back(Model(this, id));
 }
 
 void SOM::deleteModels() {
-  for(vector<Model*>::iterator i = models.begin(); i != models.end(); ++i)
-    delete *i;
+  models.clear();
+  free(modelDataAllocation);
+  free(batchDataAllocation);
+}
+
+SOM::uint SOM::getPaddedSize(uint size) {
+  return (size + FLOATS_PER_CACHE_LINE - 1) / FLOATS_PER_CACHE_LINE * FLOATS_PER_CACHE_LINE;
+}
+
+void SOM::setInstructionSet(SOMKernels::InstructionSet _instructionSet) {
+  instructionSet = SOMKernels::isSupported(_instructionSet) ? _instructionSet : SOMKernels::Scalar;
+  // kernels are always called with the model stride, so the fixed-size
+  // variants are used whenever the stride has them
+  uint stride = getPaddedSize(inputSize);
+  squaredDistanceKernel = SOMKernels::getSquaredDistanceFunction(instructionSet, stride);
+  moveTowardsKernel = SOMKernels::getMoveTowardsFunction(instructionSet, stride);
+  dotProductKernel = SOMKernels::getDotProductFunction(instructionSet, stride);
+  scaledRootKernel = SOMKernels::getScaledRootFunction(instructionSet);
+}
+
+SOMKernels::InstructionSet SOM::getInstructionSet() const {
+  return instructionSet;
+}
+
+void SOM::setNumThreads(uint numThreads) {
+  delete threadPool;
+  threadPool = NULL;
+  if(numThreads > 1)
+    threadPool = new ThreadPool(numThreads);
+}
+
+SOM::uint SOM::getNumThreads() const {
+  return threadPool ? threadPool->getNumThreads() : 1;
+}
+
+const float *SOM::padInput(const Sample &input) {
+  memcpy(paddedInput, &input[0], sizeof(float) * inputSize);
+  return paddedInput;
 }
 
 SOM::Sample SOM::createSample(const float *values) const {
@@ -70,23 +241,23 @@ void SOM::setLearningParameter(float x) {
 }
 
 const float* SOM::getModel(uint id) const {
-  return models[id]->getValues();
+  return modelData + id * modelStride;
 }
 
 SOM::uint SOM::getWinner(const Sample &input) const {
   float diff;
   float closest = 0;
   uint winner = 0;
-  uint modelIndex = 0;
-  Model *model;
-  for(vector<Model*>::const_iterator i = models.begin(); i != models.end(); ++i) {
-    model = *i;
-    diff = model->getDistance(input);
-    if(i == models.begin() || diff < closest) {
+  const float *modelValues = modelData;
+  PaddedSample paddedSample(&input[0], inputSize, modelStride);
+  const float *inputValues = paddedSample.getValues();
+  for(uint modelIndex = 0; modelIndex < numModels; modelIndex++) {
+    diff = squaredDistanceKernel(modelValues, inputValues, modelStride);
+    if(modelIndex == 0 || diff < closest) {
       closest = diff;
       winner = modelIndex;
     }
-    modelIndex++;
+    modelValues += modelStride;
   }
   return winner;
 }
@@ -96,85 +267,547 @@ SOM::uint SOM::getLastWinner() const {
 }
 
 void SOM::train(const Sample &input) {
-  lastWinnerId = getWinnerAndStoreOutput(input, lastOutput);
-  Model *winnerModel = models[lastWinnerId];
-  winnerModel->updateToInput(input);
-}
-
-SOM::uint SOM::getWinnerAndStoreOutput(const Sample &input, Output &output) {
-  uint winnerId = 0;
-  float distance, localDistanceMin = 0, localDistanceMax = 0;
-  float modelOutput, localOutputMin = 0, localOutputMax = 0;
-  Model *model;
-
-  output.clear();
-  uint modelId = 0;
-  for(vector<Model*>::iterator i = models.begin(); i != models.end(); ++i) {
-    model = *i;
-    distance = model->getDistance(input);
-    modelOutput = (float) (::sqrt(distance) / maxDistance);
-    if(i == models.begin()) {
-      localDistanceMin = localDistanceMax = distance;
-      winnerId = modelId;
-      localOutputMin = localOutputMax = modelOutput;
+  const float *inputValues = padInput(input);
+  if(!localSearchEnabled || !searchLocally(inputValues)) {
+    if(pyramid)
+      searchHierarchically(inputValues);
+    else
+      searchExhaustively(inputValues);
+  }
+  models[lastWinnerId].updateToInput(inputValues);
+  numTrainings++;
+  if(modelPublisher)
+    publishModels();
+}
+
+void SOM::setModelPublication(bool enabled, uint numBuffers) {
+  delete modelPublisher;
+  modelPublisher = enabled ? new ModelPublisher(numModels, modelStride, numBuffers) : NULL;
+  if(modelPublisher)
+    publishModels();
+}
+
+void SOM::publishModels() {
+  if(modelPublisher)
+    modelPublisher->publish(modelData, numTrainings);
+}
+
+void SOM::searchExhaustively(const float *inputValues) {
+  lastWinnerId = getWinnerAndStoreDistances(inputValues, lastSquaredDistances);
+  numSearchesSinceFullScan = 0;
+  numFullSearches++;
+}
+
+void SOM::setLocalSearch(bool enabled, uint _fullScanInterval, float errorThreshold) {
+  localSearchEnabled = enabled;
+  fullScanInterval = _fullScanInterval;
+  localSearchErrorThreshold = errorThreshold;
+  numSearchesSinceFullScan = fullScanInterval; // start with a full scan
+}
+
+float SOM::getLocalSearchRate() const {
+  unsigned long numSearches = numLocalSearches + numFullSearches;
+  return numSearches > 0 ? (float) numLocalSearches / numSearches : 0;
+}
+
+bool SOM::searchLocally(const float *inputValues) {
+  if(numSearchesSinceFullScan >= fullScanInterval)
+    return false;
+
+  // descend from the last winner to the adjacent model closest to the input until none is closer
+  uint winnerId = lastWinnerId;
+  float closest = squaredDistanceKernel(modelData + winnerId * modelStride, inputValues, modelStride);
+  float distance;
+  uint current;
+  do {
+    current = winnerId;
+    const vector<unsigned int> &adjacentNodes = topology->getAdjacentNodes(current);
+    for(vector<unsigned int>::const_iterator i = adjacentNodes.begin(); i != adjacentNodes.end(); ++i) {
+      distance = squaredDistanceKernel(modelData + *i * modelStride, inputValues, modelStride);
+      if(distance < closest) {
+	closest = distance;
+	winnerId = *i;
+      }
+    }
+  } while(winnerId != current);
+
+  float winnerOutput = (float) (::sqrt(closest) / maxDistance);
+  if(winnerOutput > localSearchErrorThreshold)
+    return false;
+
+  lastWinnerId = winnerId;
+  outputsOutdated = true;
+  numSearchesSinceFullScan++;
+  numLocalSearches++;
+  return true;
+}
+
+void SOM::setHierarchicalSearch(bool enabled, uint _beamWidth, uint _verificationInterval) {
+  delete pyramid;
+  pyramid = NULL;
+  gridTopology = NULL;
+  if(enabled) {
+    gridTopology = dynamic_cast<RectGridTopology *>(topology);
+    if(!gridTopology)
+      throw std::runtime_error("hierarchical search requires a rectangular grid topology");
+    pyramid = new CodebookPyramid(gridTopology->getGridWidth(), gridTopology->getGridHeight(), modelStride);
+  }
+  beamWidth = _beamWidth;
+  verificationInterval = _verificationInterval;
+  numSearchesSinceVerification = 0;
+  numHierarchicalSearches = 0;
+  numVerifiedSearches = 0;
+  numCorrectVerifiedSearches = 0;
+}
+
+float SOM::getHierarchicalSearchAccuracy() const {
+  return numVerifiedSearches > 0 ? (float) numCorrectVerifiedSearches / numVerifiedSearches : 0;
+}
+
+void SOM::searchHierarchically(const float *inputValues) {
+  float distance;
+  uint winnerId = pyramid->search(modelData, inputValues, beamWidth, squaredDistanceKernel, distance);
+  if(numSearchesSinceVerification >= verificationInterval) {
+    searchExhaustively(inputValues);
+    numVerifiedSearches++;
+    if(winnerId == lastWinnerId || distance <= squaredDistanceKernel(modelData + lastWinnerId * modelStride,
+								    inputValues, modelStride))
+      numCorrectVerifiedSearches++;
+    numSearchesSinceVerification = 0;
+    return;
+  }
+
+  lastWinnerId = winnerId;
+  outputsOutdated = true;
+  numSearchesSinceVerification++;
+  numHierarchicalSearches++;
+}
+
+// marks the pyramid cells covering the models moved by an update around centreId
+void SOM::invalidatePyramid(uint centreId) {
+  if(!pyramid)
+    return;
+  uint x, y;
+  gridTopology->idToGridCoordinates(centreId, x, y);
+  int xMin = x, xMax = x, yMin = y, yMax = y;
+  const Topology::Stencil *stencil = topology->getStencil();
+  if(stencil) {
+    for(vector<Topology::StencilRow>::const_iterator row = stencil->rows.begin(); row != stencil->rows.end(); ++row) {
+      yMin = min(yMin, (int) y + row->dy);
+      yMax = max(yMax, (int) y + row->dy);
+      xMin = min(xMin, (int) x + row->dxMin);
+      xMax = max(xMax, (int) x + row->dxMin + (int) row->strengths.size() - 1);
+    }
+  }
+  else {
+    const vector<Topology::Neighbour> &neighbours = topology->getNeighbours(centreId);
+    uint nx, ny;
+    for(vector<Topology::Neighbour>::const_iterator i = neighbours.begin(); i != neighbours.end(); ++i) {
+      gridTopology->idToGridCoordinates(i->nodeId, nx, ny);
+      xMin = min(xMin, (int) nx);
+      xMax = max(xMax, (int) nx);
+      yMin = min(yMin, (int) ny);
+      yMax = max(yMax, (int) ny);
+    }
+  }
+  int gridWidth = gridTopology->getGridWidth();
+  int gridHeight = gridTopology->getGridHeight();
+  pyramid->invalidate(max(xMin, 0), max(yMin, 0), min(xMax, gridWidth - 1), min(yMax, gridHeight - 1));
+}
+
+void SOM::setDirtyTracking(bool enabled) {
+  dirtyTracking = enabled;
+  modelDirty.assign(enabled ? numModels : 0, 0);
+  dirtyModels.clear();
+}
+
+void SOM::clearDirtyModels() {
+  for(vector<uint>::const_iterator i = dirtyModels.begin(); i != dirtyModels.end(); ++i)
+    modelDirty[*i] = 0;
+  dirtyModels.clear();
+}
+
+// called after the models around centreId have been moved towards an input
+void SOM::modelsMoved(uint centreId) {
+  invalidatePyramid(centreId);
+  if(dirtyTracking)
+    markNeighbourhoodDirty(centreId);
+}
+
+// marks the same models as applyStencil or the neighbour list update touches
+void SOM::markNeighbourhoodDirty(uint centreId) {
+  markModelDirty(centreId);
+  const Topology::Stencil *stencil = topology->getStencil();
+  if(!stencil) {
+    const vector<Topology::Neighbour> &neighbours = topology->getNeighbours(centreId);
+    for(vector<Topology::Neighbour>::const_iterator i = neighbours.begin(); i != neighbours.end(); ++i)
+      markModelDirty(i->nodeId);
+    return;
+  }
+
+  int width = stencil->width;
+  int height = stencil->height;
+  int centreX = centreId % width;
+  int centreY = centreId / width;
+  int y, x, kBegin, kEnd;
+  for(vector<Topology::StencilRow>::const_iterator row = stencil->rows.begin(); row != stencil->rows.end(); ++row) {
+    y = centreY + row->dy;
+    if(y < 0 || y >= height)
+      continue;
+    int numColumns = row->strengths.size();
+    x = centreX + row->dxMin;
+    if(stencil->wrapAround) {
+      x = ((x % width) + width) % width;
+      for(int k = 0; k < numColumns && k < width; k++)
+	markModelDirty(y * width + (x + k) % width);
+    }
+    else {
+      kBegin = x < 0 ? -x : 0;
+      kEnd = x + numColumns > width ? width - x : numColumns;
+      for(int k = kBegin; k < kEnd; k++)
+	markModelDirty(y * width + x + k);
+    }
+  }
+}
+
+void SOM::markAllModelsDirty() {
+  if(dirtyTracking)
+    for(uint id = 0; id < numModels; id++)
+      markModelDirty(id);
+}
+
+void SOM::trainBatch(const vector<Sample> &inputs) {
+  uint numSamples = inputs.size();
+  if(numSamples == 0)
+    return;
+  if(numSamples == 1) {
+    train(inputs[0]);
+    return;
+  }
+
+  padBatch(inputs);
+  updateModelNorms();
+  lastSquaredDistances.resize(numModels);
+
+  // search all winners against the models as they were before the batch
+  vector<SearchResult> results(numSamples);
+  if(threadPool) {
+    uint numChunks = threadPool->getNumChunks(numModels, MIN_MODELS_PER_SEARCH_CHUNK);
+    BatchSearchTask task(this, numSamples, &lastSquaredDistances[0], numChunks);
+    threadPool->run(task, numModels, MIN_MODELS_PER_SEARCH_CHUNK);
+    for(uint b = 0; b < numSamples; b++) {
+      results[b] = task.results[b];
+      for(uint chunk = 1; chunk < numChunks; chunk++)
+	mergeSearchResults(results[b], task.results[chunk * numSamples + b]);
+    }
+  }
+  else {
+    searchWinnersInBatch(numSamples, 0, numModels, &results[0], &lastSquaredDistances[0]);
+  }
+
+  // then move every model once, by the accumulated update
+  for(uint b = 0; b < numSamples; b++)
+    accumulateBatchUpdate(results[b].winnerId, batchData + b * modelStride);
+  applyBatchUpdate();
+  for(uint b = 0; b < numSamples; b++)
+    modelsMoved(results[b].winnerId);
+
+  lastWinnerId = results[numSamples - 1].winnerId;
+  setOutputRange(results[numSamples - 1]);
+  numFullSearches += numSamples;
+  numSearchesSinceFullScan = 0;
+  numTrainings += numSamples;
+  if(modelPublisher)
+    publishModels();
+}
+
+void SOM::padBatch(const vector<Sample> &inputs) {
+  uint numSamples = inputs.size();
+  if(numSamples > batchCapacity) {
+    free(batchDataAllocation);
+    batchData = allocateAligned(modelStride * numSamples, &batchDataAllocation);
+    batchCapacity = numSamples;
+  }
+  batchNorms.resize(numSamples);
+  float *sample = batchData;
+  for(uint b = 0; b < numSamples; b++) {
+    memcpy(sample, &inputs[b][0], sizeof(float) * inputSize);
+    batchNorms[b] = dotProductKernel(sample, sample, modelStride);
+    sample += modelStride;
+  }
+}
+
+void SOM::updateModelNorms() {
+  modelNorms.resize(numModels);
+  const float *modelValues = modelData;
+  for(uint modelId = 0; modelId < numModels; modelId++) {
+    modelNorms[modelId] = dotProductKernel(modelValues, modelValues, modelStride);
+    modelValues += modelStride;
+  }
+}
+
+// the winner has strength 1, as in Model::updateToInput
+void SOM::accumulateBatchUpdate(uint winnerId, const float *input) {
+  if(batchStrengths.empty()) {
+    batchMeans.resize(numModels * modelStride);
+    batchStrengths.resize(numModels, 0);
+  }
+  addToBatchMean(winnerId, input, 1);
+  const vector<Topology::Neighbour> &neighbours = topology->getNeighbours(winnerId);
+  for(vector<Topology::Neighbour>::const_iterator i = neighbours.begin(); i != neighbours.end(); ++i)
+    addToBatchMean(i->nodeId, input, (float) i->strength);
+}
+
+// the mean is kept as a running mean, so that the input need not be scaled
+void SOM::addToBatchMean(uint modelId, const float *input, float strength) {
+  if(strength <= 0)
+    return;
+  float *mean = &batchMeans[modelId * modelStride];
+  if(batchStrengths[modelId] == 0) {
+    batchModels.push_back(modelId);
+    memcpy(mean, input, sizeof(float) * modelStride);
+    batchStrengths[modelId] = strength;
+    return;
+  }
+  batchStrengths[modelId] += strength;
+  moveTowardsKernel(mean, input, modelStride, strength / batchStrengths[modelId]);
+}
+
+void SOM::applyBatchUpdate() {
+  for(vector<uint>::const_iterator i = batchModels.begin(); i != batchModels.end(); ++i) {
+    float strength = min(batchStrengths[*i], 1.0f);
+    moveTowardsKernel(modelData + *i * modelStride, &batchMeans[*i * modelStride], modelStride,
+		      learningParameter * strength);
+    batchStrengths[*i] = 0;
+  }
+  batchModels.clear();
+}
+
+// squared distances are expanded as |m|^2 + |x|^2 - 2 m.x; the distances
+// to all models are only stored for the last sample
+void SOM::searchWinnersInBatch(uint numSamples, uint begin, uint end,
+			       SearchResult *results, float *lastSquaredDistances) const {
+  uint last = numSamples - 1;
+  float distance;
+  const float *modelValues;
+  const float *sample;
+  SearchResult emptyResult = { 0, 0, 0 };
+  for(uint b = 0; b < numSamples; b++)
+    results[b] = emptyResult;
+
+  for(uint blockBegin = begin; blockBegin < end; blockBegin += MODELS_PER_BATCH_BLOCK) {
+    uint blockEnd = blockBegin + MODELS_PER_BATCH_BLOCK < end ? blockBegin + MODELS_PER_BATCH_BLOCK : end;
+    sample = batchData;
+    for(uint b = 0; b < numSamples; b++) {
+      SearchResult &result = results[b];
+      modelValues = modelData + blockBegin * modelStride;
+      for(uint modelId = blockBegin; modelId < blockEnd; modelId++) {
+	distance = modelNorms[modelId] + batchNorms[b]
+	  - 2 * dotProductKernel(modelValues, sample, modelStride);
+	if(distance < 0)
+	  distance = 0;
+	if(b == last) {
+	  lastSquaredDistances[modelId] = distance;
+	  if(modelId == begin || distance > result.distanceMax)
+	    result.distanceMax = distance;
+	}
+	if(modelId == begin || distance < result.distanceMin) {
+	  result.distanceMin = distance;
+	  result.winnerId = modelId;
+	}
+	modelValues += modelStride;
+      }
+      sample += modelStride;
     }
-    else if(distance < localDistanceMin) {
-      localDistanceMin = distance;
-      winnerId = modelId;
-      localOutputMin = modelOutput;
+  }
+}
+
+SOM::uint SOM::getWinnerAndStoreDistances(const float *inputValues, vector<float> &squaredDistances) {
+  SearchResult result;
+  squaredDistances.resize(numModels);
+
+  if(threadPool) {
+    // chunks are merged in model order, which gives the same result as a sequential search
+    WinnerSearchTask task(this, inputValues, &squaredDistances[0],
+			  threadPool->getNumChunks(numModels, MIN_MODELS_PER_SEARCH_CHUNK));
+    threadPool->run(task, numModels, MIN_MODELS_PER_SEARCH_CHUNK);
+    result = task.results[0];
+    for(vector<SearchResult>::const_iterator i = task.results.begin() + 1; i != task.results.end(); ++i)
+      mergeSearchResults(result, *i);
+  }
+  else {
+    searchWinner(inputValues, 0, numModels, &squaredDistances[0], result);
+  }
+
+  setOutputRange(result);
+  return result.winnerId;
+}
+
+void SOM::searchWinner(const float *inputValues, uint begin, uint end, float *squaredDistances,
+		       SearchResult &result) const {
+  float distance;
+  const float *modelValues = modelData + begin * modelStride;
+  float *distancePtr = squaredDistances + begin;
+
+  for(uint modelId = begin; modelId < end; modelId++) {
+    distance = squaredDistanceKernel(modelValues, inputValues, modelStride);
+    if(modelId == begin) {
+      result.distanceMin = result.distanceMax = distance;
+      result.winnerId = modelId;
+    }
+    else if(distance < result.distanceMin) {
+      result.distanceMin = distance;
+      result.winnerId = modelId;
     }
-    else if(distance > localDistanceMax) {
-      localDistanceMax = distance;
-      localOutputMax = modelOutput;
+    else if(distance > result.distanceMax) {
+      result.distanceMax = distance;
     }
-    output.push_back(modelOutput);
-    modelId++;
+    *distancePtr++ = distance;
+    modelValues += modelStride;
   }
+}
+
+void SOM::mergeSearchResults(SearchResult &result, const SearchResult &following) {
+  if(following.distanceMin < result.distanceMin) {
+    result.distanceMin = following.distanceMin;
+    result.winnerId = following.winnerId;
+  }
+  if(following.distanceMax > result.distanceMax)
+    result.distanceMax = following.distanceMax;
+}
 
-  outputMin = localOutputMin;
-  outputMax = localOutputMax;
-  return winnerId;
+void SOM::setOutputRange(const SearchResult &result) const {
+  outputMin = (float) (::sqrt(result.distanceMin) / maxDistance);
+  outputMax = (float) (::sqrt(result.distanceMax) / maxDistance);
+  outputsOutdated = false;
+}
+
+// after a search that didn't visit all models, the distances are computed
+// on first use, from the last training input (still in the input row)
+void SOM::updateOutputs() const {
+  if(!outputsOutdated)
+    return;
+  SearchResult result;
+  lastSquaredDistances.resize(numModels);
+  searchWinner(paddedInput, 0, numModels, &lastSquaredDistances[0], result);
+  setOutputRange(result);
 }
 
 void SOM::getOutput(const Sample &input, Output &output) const {
-  ((SOM *)this)->getWinnerAndStoreOutput(input, output);
+  PaddedSample paddedSample(&input[0], inputSize, modelStride);
+  SearchResult result;
+  output.resize(numModels);
+  searchWinner(paddedSample.getValues(), 0, numModels, &output[0], result);
+  scaledRootKernel(&output[0], &output[0], numModels, 1.0f / maxDistance, 0);
 }
 
 void SOM::getLastOutput(Output &output) const {
-  output = lastOutput;
+  updateOutputs();
+  output.resize(lastSquaredDistances.size());
+  if(!output.empty())
+    scaledRootKernel(&lastSquaredDistances[0], &output[0], output.size(), 1.0f / maxDistance, 0);
 }
 
 float SOM::getOutputMin() const {
+  updateOutputs();
   return outputMin;
 }
 
 float SOM::getOutputMax() const {
+  updateOutputs();
   return outputMax;
 }
 
 void SOM::setModel(uint modelIndex, const Sample &sample) {
-  models[modelIndex]->set(sample);
+  models[modelIndex].set(sample);
+  if(dirtyTracking)
+    markModelDirty(modelIndex);
+  if(pyramid) {
+    uint x, y;
+    gridTopology->idToGridCoordinates(modelIndex, x, y);
+    pyramid->invalidate(x, y, x, y);
+  }
 }
 
 void SOM::setAllModels(const Sample &sample) {
-  Model *model;
-  for(vector<Model*>::iterator i = models.begin(); i != models.end(); ++i) {
-    model = *i;
-    model->set(sample);
-  }
+  for(vector<Model>::iterator i = models.begin(); i != models.end(); ++i)
+    i->set(sample);
+  markAllModelsDirty();
+  if(pyramid)
+    pyramid->invalidate();
 }
 
-void SOM::setRandomModelValues(float min, float max) {
-  Model *model;
-  for(vector<Model*>::iterator i = models.begin(); i != models.end(); ++i) {
-    model = *i;
-    model->setRandomValues(min, max);
-  }
+void SOM::setModels(const float *values, uint stride) {
+  for(uint modelId = 0; modelId < numModels; modelId++)
+    memcpy(modelData + modelId * modelStride, values + modelId * stride, sizeof(float) * inputSize);
+  markAllModelsDirty();
+  if(pyramid)
+    pyramid->invalidate();
+}
+
+void SOM::setRandomSeed(uint64_t seed) {
+  randomStream.setSeed(seed);
+  randomSeedSet = true;
+  numRandomInitializations = 0;
 }
 
-void SOM::updateNeighbourLists() {
-  for(vector<Model*>::iterator i = models.begin(); i != models.end(); ++i)
-    (*i)->updateNeighbourList();
+void SOM::setRandomModelValues(float min, float max) {
+  if(!randomSeedSet)
+    randomStream.setSeed((uint64_t) rand());
+  uint64_t firstCounter = (uint64_t) numRandomInitializations++ * numModels * inputSize;
+  ModelInitializationTask task(this, firstCounter, min, max);
+  if(threadPool)
+    threadPool->run(task, numModels, MIN_MODELS_PER_INITIALIZATION_CHUNK);
+  else
+    task.run(0, 0, numModels);
+  markAllModelsDirty();
+  if(pyramid)
+    pyramid->invalidate();
+}
+
+void SOM::applyStencil(const Topology::Stencil &stencil, uint centreId, const float *input,
+		       uint rowBegin, uint rowEnd) {
+  int width = stencil.width;
+  int height = stencil.height;
+  int centreX = centreId % width;
+  int centreY = centreId / width;
+  int y, x, kBegin, kEnd;
+  float *modelValues;
+
+  for(uint r = rowBegin; r < rowEnd; r++) {
+    const Topology::StencilRow &row = stencil.rows[r];
+    y = centreY + row.dy;
+    if(y < 0 || y >= height)
+      continue;
+    const float *strength = &row.strengths[0];
+    int numColumns = row.strengths.size();
+    x = centreX + row.dxMin;
+
+    if(stencil.wrapAround) {
+      x = ((x % width) + width) % width;
+      modelValues = modelData + (y * width + x) * modelStride;
+      for(int k = 0; k < numColumns; k++) {
+	moveTowardsKernel(modelValues, input, modelStride, learningParameter * strength[k]);
+	if(++x == width) {
+	  x = 0;
+	  modelValues = modelData + y * width * modelStride;
+	}
+	else {
+	  modelValues += modelStride;
+	}
+      }
+    }
+    else {
+      // clip the row to the grid, leaving a contiguous run of models
+      kBegin = x < 0 ? -x : 0;
+      kEnd = x + numColumns > width ? width - x : numColumns;
+      modelValues = modelData + (y * width + x + kBegin) * modelStride;
+      for(int k = kBegin; k < kEnd; k++) {
+	moveTowardsKernel(modelValues, input, modelStride, learningParameter * strength[k]);
+	modelValues += modelStride;
+      }
+    }
+  }
 }
 
 SOM::ActivationPattern *SOM::createActivationPattern() const {
@@ -185,14 +818,13 @@ SOM::ActivationPattern *SOM::createActivationPattern() const {
 }
 
 void SOM::getActivationPattern(ActivationPattern *activationPattern) const {
+  updateOutputs();
   float range = outputMax - outputMin;
   if(range > 0) {
-    ActivationPattern::iterator activationPatternNode = activationPattern->begin();
-    for(Output::const_iterator lastOutputNode = lastOutput.begin();
-	lastOutputNode != lastOutput.end(); lastOutputNode++) {
-      *activationPatternNode = 1.0f - (*lastOutputNode - outputMin) / range;
-      activationPatternNode++;
-    }
+    // 1 - (output - outputMin) / range, where output = sqrt(squared distance) / maxDistance
+    if(!lastSquaredDistances.empty())
+      scaledRootKernel(&lastSquaredDistances[0], &(*activationPattern)[0], lastSquaredDistances.size(),
+		       -1.0f / (maxDistance * range), 1.0f + outputMin / range);
   }
   else {
     fill(activationPattern->begin(), activationPattern->end(), 0);
@@ -200,53 +832,52 @@ void SOM::getActivationPattern(ActivationPattern *activationPattern) const {
 }
 
 void SOM::writeModelData(ostream &f) const {
-  f << inputSize << endl;
-  for(vector<Model*>::const_iterator i = models.begin(); i != models.end(); ++i)
-    (*i)->writeData(f);
+  f << inputSize << '\n';
+  for(vector<Model>::const_iterator i = models.begin(); i != models.end(); ++i)
+    i->writeData(f);
 }
 
 
-SOM::Model::Model(const SOM *_parent, uint _id) {
+SOM::Model::Model(SOM *_parent, uint _id) {
   id = _id;
   parent = _parent;
   inputSize = parent->inputSize;
-  values = new float [inputSize];
-  neighbourhoodParameter = 0;
-}
-
-SOM::Model::~Model() {
-  delete [] values;
+  values = parent->modelData + id * parent->modelStride;
 }
 
-void SOM::Model::updateToInput(const SOM::Sample &input) {
+void SOM::Model::updateToInput(const float *input) {
   float learningParameter = parent->learningParameter;
-  moveTowards(input, learningParameter);
+  const Topology::Stencil *stencil = parent->topology->getStencil();
+  if(stencil) {
+    // the stencil includes the winner itself with strength 1
+    uint numRows = stencil->rows.size();
+    if(parent->threadPool) {
+      StencilUpdateTask task(parent, *stencil, id, input);
+      parent->threadPool->run(task, numRows, MIN_STENCIL_ROWS_PER_UPDATE_CHUNK);
+    }
+    else {
+      parent->applyStencil(*stencil, id, input, 0, numRows);
+    }
+    parent->modelsMoved(id);
+    return;
+  }
 
-  updateNeighbourList();
-  for(std::vector<Neighbour>::iterator i = neighbours.begin(); i != neighbours.end(); i++)
-    i->model->moveTowards(input, learningParameter * i->strength);
-}
+  moveTowards(input, learningParameter);
 
-void SOM::Model::moveTowards(const std::vector<float > &sample, float amount) {
-  float *valuePtr = values;
-  Sample::const_iterator samplePtr = sample.begin();
-  for(uint k = 0; k < inputSize; k++) {
-    *valuePtr += amount * (*samplePtr - *valuePtr);
-    valuePtr++;
-    samplePtr++;
+  const std::vector<Topology::Neighbour> &neighbours = parent->topology->getNeighbours(id);
+  if(parent->threadPool) {
+    NeighbourUpdateTask task(parent, neighbours, input);
+    parent->threadPool->run(task, neighbours.size(), MIN_NEIGHBOURS_PER_UPDATE_CHUNK);
   }
+  else {
+    for(std::vector<Topology::Neighbour>::const_iterator i = neighbours.begin(); i != neighbours.end(); i++)
+      parent->models[i->nodeId].moveTowards(input, learningParameter * (float) i->strength);
+  }
+  parent->modelsMoved(id);
 }
 
-float SOM::Model::getDistance(const Sample &input) {
-  float *valuePtr = values;
-  Sample::const_iterator samplePtr = input.begin();
-  float d;
-  float distance = 0;
-  for(uint k = 0; k < inputSize; k++) {
-    d = *valuePtr++ - *samplePtr++;
-    distance += d * d;
-  }
-  return distance;
+void SOM::Model::moveTowards(const float *input, float amount) {
+  parent->moveTowardsKernel(values, input, parent->modelStride, amount);
 }
 
 void SOM::Model::set(const Sample &sample) {
@@ -256,29 +887,12 @@ void SOM::Model::set(const Sample &sample) {
     *valuePtr++ = *samplePtr++;
 }
 
-void SOM::Model::setRandomValues(float min, float max) {
-  float *valuePtr = values;
-  for(uint k = 0; k < inputSize; k++)
-    *valuePtr++ = randomInRange(min, max);
-}
-
-void SOM::Model::updateNeighbourList() {
-  if(neighbourhoodParameter != parent->neighbourhoodParameter) {
-    std::vector<Topology::Neighbour> topologyNeighbours;
-    parent->topology->getNeighbours(id, topologyNeighbours);
-    neighbours.clear();
-    Neighbour neighbour;
-    for(std::vector<Topology::Neighbour>::iterator i = topologyNeighbours.begin(); i != topologyNeighbours.end(); i++) {
-      neighbour.model = parent->models[i->nodeId];
-      neighbour.strength = i->strength;
-      neighbours.push_back(neighbour);
-    }
-    neighbourhoodParameter = parent->neighbourhoodParameter;
-  }
+void SOM::Model::setRandomValues(const RandomStream &stream, uint64_t firstCounter, float min, float max) {
+  stream.fillInRange(firstCounter, values, inputSize, min, max);
 }
 
 void SOM::Model::writeData(ostream &f) const {
   float *valuePtr = values;
   for(uint k = 0; k < inputSize; k++)
-    f << *valuePtr++ << endl;
+    f << *valuePtr++ << '\n';
 }
@@ -0,0 +1,719 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "SOMKernels.hpp"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SONOTOPY_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace sonotopy;
+
+// the generic kernels are inlined into the fixed-size variants below,
+// where the constant size lets the compiler unroll them
+#ifdef __GNUC__
+#define KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define KERNEL_INLINE inline
+#endif
+
+// vector loops are unrolled completely when their trip count is constant
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8
+#define UNROLL_VECTOR_LOOP _Pragma("GCC unroll 16")
+#else
+#define UNROLL_VECTOR_LOOP
+#endif
+
+static KERNEL_INLINE float squaredDistanceScalar(const float *model, const float *input, unsigned int size) {
+  float d;
+  float distance = 0;
+  for(unsigned int k = 0; k < size; k++) {
+    d = *model++ - *input++;
+    distance += d * d;
+  }
+  return distance;
+}
+
+static KERNEL_INLINE void moveTowardsScalar(float *model, const float *input, unsigned int size, float amount) {
+  for(unsigned int k = 0; k < size; k++) {
+    *model += amount * (*input - *model);
+    model++;
+    input++;
+  }
+}
+
+static KERNEL_INLINE float dotProductScalar(const float *a, const float *b, unsigned int size) {
+  float sum = 0;
+  for(unsigned int k = 0; k < size; k++)
+    sum += *a++ * *b++;
+  return sum;
+}
+
+static void scaledRootScalar(const float *squaredDistances, float *output, unsigned int size,
+			     float scale, float offset) {
+  for(unsigned int k = 0; k < size; k++)
+    *output++ = offset + scale * sqrtf(*squaredDistances++);
+}
+
+static float halfSquaredDistanceScalar(const unsigned short *model, const float *input, unsigned int size) {
+  float d;
+  float distance = 0;
+  for(unsigned int k = 0; k < size; k++) {
+    d = SOMKernels::halfToFloat(*model++) - *input++;
+    distance += d * d;
+  }
+  return distance;
+}
+
+static float byteSquaredDistanceScalar(const unsigned char *model, const float *scale,
+				       const float *shiftedInput, unsigned int size) {
+  float d;
+  float distance = 0;
+  for(unsigned int k = 0; k < size; k++) {
+    d = *scale++ * *model++ - *shiftedInput++;
+    distance += d * d;
+  }
+  return distance;
+}
+
+#ifdef SONOTOPY_X86_KERNELS
+
+__attribute__((target("sse2")))
+static KERNEL_INLINE float squaredDistanceSSE2(const float *model, const float *input, unsigned int size) {
+  __m128 sum = _mm_setzero_ps();
+  __m128 d;
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 4 <= size; k += 4) {
+    d = _mm_sub_ps(_mm_loadu_ps(model + k), _mm_loadu_ps(input + k));
+    sum = _mm_add_ps(sum, _mm_mul_ps(d, d));
+  }
+  float partialSums[4];
+  _mm_storeu_ps(partialSums, sum);
+  float distance = partialSums[0] + partialSums[1] + partialSums[2] + partialSums[3];
+  return distance + squaredDistanceScalar(model + k, input + k, size - k);
+}
+
+__attribute__((target("sse2")))
+static KERNEL_INLINE void moveTowardsSSE2(float *model, const float *input, unsigned int size, float amount) {
+  __m128 a = _mm_set1_ps(amount);
+  __m128 m;
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 4 <= size; k += 4) {
+    m = _mm_loadu_ps(model + k);
+    m = _mm_add_ps(m, _mm_mul_ps(a, _mm_sub_ps(_mm_loadu_ps(input + k), m)));
+    _mm_storeu_ps(model + k, m);
+  }
+  moveTowardsScalar(model + k, input + k, size - k, amount);
+}
+
+__attribute__((target("sse2")))
+static KERNEL_INLINE float dotProductSSE2(const float *a, const float *b, unsigned int size) {
+  __m128 sum = _mm_setzero_ps();
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 4 <= size; k += 4)
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+  float partialSums[4];
+  _mm_storeu_ps(partialSums, sum);
+  float dotProduct = partialSums[0] + partialSums[1] + partialSums[2] + partialSums[3];
+  return dotProduct + dotProductScalar(a + k, b + k, size - k);
+}
+
+__attribute__((target("sse2")))
+static void scaledRootSSE2(const float *squaredDistances, float *output, unsigned int size,
+			   float scale, float offset) {
+  __m128 s = _mm_set1_ps(scale);
+  __m128 o = _mm_set1_ps(offset);
+  unsigned int k = 0;
+  for(; k + 4 <= size; k += 4)
+    _mm_storeu_ps(output + k, _mm_add_ps(o, _mm_mul_ps(s, _mm_sqrt_ps(_mm_loadu_ps(squaredDistances + k)))));
+  scaledRootScalar(squaredDistances + k, output + k, size - k, scale, offset);
+}
+
+__attribute__((target("avx")))
+static float horizontalSum(__m256 x) {
+  __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+  sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+  return _mm_cvtss_f32(sum4);
+}
+
+__attribute__((target("avx2,fma")))
+static KERNEL_INLINE float squaredDistanceAVX2(const float *model, const float *input, unsigned int size) {
+  __m256 sum = _mm256_setzero_ps();
+  __m256 d;
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 8 <= size; k += 8) {
+    d = _mm256_sub_ps(_mm256_loadu_ps(model + k), _mm256_loadu_ps(input + k));
+    sum = _mm256_fmadd_ps(d, d, sum);
+  }
+  return horizontalSum(sum) + squaredDistanceScalar(model + k, input + k, size - k);
+}
+
+__attribute__((target("avx2,fma")))
+static KERNEL_INLINE void moveTowardsAVX2(float *model, const float *input, unsigned int size, float amount) {
+  __m256 a = _mm256_set1_ps(amount);
+  __m256 m;
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 8 <= size; k += 8) {
+    m = _mm256_loadu_ps(model + k);
+    m = _mm256_fmadd_ps(a, _mm256_sub_ps(_mm256_loadu_ps(input + k), m), m);
+    _mm256_storeu_ps(model + k, m);
+  }
+  moveTowardsScalar(model + k, input + k, size - k, amount);
+}
+
+__attribute__((target("avx2,fma")))
+static KERNEL_INLINE float dotProductAVX2(const float *a, const float *b, unsigned int size) {
+  __m256 sum = _mm256_setzero_ps();
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 8 <= size; k += 8)
+    sum = _mm256_fmadd_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k), sum);
+  return horizontalSum(sum) + dotProductScalar(a + k, b + k, size - k);
+}
+
+__attribute__((target("avx2,fma")))
+static void scaledRootAVX2(const float *squaredDistances, float *output, unsigned int size,
+			   float scale, float offset) {
+  __m256 s = _mm256_set1_ps(scale);
+  __m256 o = _mm256_set1_ps(offset);
+  unsigned int k = 0;
+  for(; k + 8 <= size; k += 8)
+    _mm256_storeu_ps(output + k, _mm256_fmadd_ps(s, _mm256_sqrt_ps(_mm256_loadu_ps(squaredDistances + k)), o));
+  scaledRootScalar(squaredDistances + k, output + k, size - k, scale, offset);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static float halfSquaredDistanceAVX2(const unsigned short *model, const float *input, unsigned int size) {
+  __m256 sum = _mm256_setzero_ps();
+  __m256 d;
+  unsigned int k = 0;
+  for(; k + 8 <= size; k += 8) {
+    d = _mm256_sub_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (model + k))),
+		      _mm256_loadu_ps(input + k));
+    sum = _mm256_fmadd_ps(d, d, sum);
+  }
+  return horizontalSum(sum) + halfSquaredDistanceScalar(model + k, input + k, size - k);
+}
+
+__attribute__((target("avx2,fma")))
+static float byteSquaredDistanceAVX2(const unsigned char *model, const float *scale,
+				     const float *shiftedInput, unsigned int size) {
+  __m256 sum = _mm256_setzero_ps();
+  __m256 q, d;
+  unsigned int k = 0;
+  for(; k + 8 <= size; k += 8) {
+    q = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) (model + k))));
+    d = _mm256_fmsub_ps(_mm256_loadu_ps(scale + k), q, _mm256_loadu_ps(shiftedInput + k));
+    sum = _mm256_fmadd_ps(d, d, sum);
+  }
+  return horizontalSum(sum) + byteSquaredDistanceScalar(model + k, scale + k, shiftedInput + k, size - k);
+}
+
+__attribute__((target("avx512f")))
+static KERNEL_INLINE float squaredDistanceAVX512(const float *model, const float *input, unsigned int size) {
+  __m512 sum = _mm512_setzero_ps();
+  __m512 d;
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 16 <= size; k += 16) {
+    d = _mm512_sub_ps(_mm512_loadu_ps(model + k), _mm512_loadu_ps(input + k));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+  float partialSums[16];
+  _mm512_storeu_ps(partialSums, sum);
+  float distance = 0;
+  for(unsigned int i = 0; i < 16; i++)
+    distance += partialSums[i];
+  return distance + squaredDistanceScalar(model + k, input + k, size - k);
+}
+
+__attribute__((target("avx512f")))
+static KERNEL_INLINE void moveTowardsAVX512(float *model, const float *input, unsigned int size, float amount) {
+  __m512 a = _mm512_set1_ps(amount);
+  __m512 m;
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 16 <= size; k += 16) {
+    m = _mm512_loadu_ps(model + k);
+    m = _mm512_fmadd_ps(a, _mm512_sub_ps(_mm512_loadu_ps(input + k), m), m);
+    _mm512_storeu_ps(model + k, m);
+  }
+  moveTowardsScalar(model + k, input + k, size - k, amount);
+}
+
+__attribute__((target("avx512f")))
+static KERNEL_INLINE float dotProductAVX512(const float *a, const float *b, unsigned int size) {
+  __m512 sum = _mm512_setzero_ps();
+  unsigned int k = 0;
+  UNROLL_VECTOR_LOOP
+  for(; k + 16 <= size; k += 16)
+    sum = _mm512_fmadd_ps(_mm512_loadu_ps(a + k), _mm512_loadu_ps(b + k), sum);
+  float partialSums[16];
+  _mm512_storeu_ps(partialSums, sum);
+  float dotProduct = 0;
+  for(unsigned int i = 0; i < 16; i++)
+    dotProduct += partialSums[i];
+  return dotProduct + dotProductScalar(a + k, b + k, size - k);
+}
+
+__attribute__((target("avx512f")))
+static float halfSquaredDistanceAVX512(const unsigned short *model, const float *input, unsigned int size) {
+  __m512 sum = _mm512_setzero_ps();
+  __m512 d;
+  __mmask16 all = (__mmask16) 0xffff;
+  unsigned int k = 0;
+  // zero-masked conversions, see scaledRootAVX512
+  for(; k + 16 <= size; k += 16) {
+    d = _mm512_sub_ps(_mm512_maskz_cvtph_ps(all, _mm256_loadu_si256((const __m256i *) (model + k))),
+		      _mm512_loadu_ps(input + k));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+  float partialSums[16];
+  _mm512_storeu_ps(partialSums, sum);
+  float distance = 0;
+  for(unsigned int i = 0; i < 16; i++)
+    distance += partialSums[i];
+  return distance + halfSquaredDistanceScalar(model + k, input + k, size - k);
+}
+
+__attribute__((target("avx512f")))
+static float byteSquaredDistanceAVX512(const unsigned char *model, const float *scale,
+				       const float *shiftedInput, unsigned int size) {
+  __m512 sum = _mm512_setzero_ps();
+  __m512 q, d;
+  __mmask16 all = (__mmask16) 0xffff;
+  unsigned int k = 0;
+  for(; k + 16 <= size; k += 16) {
+    q = _mm512_maskz_cvtepi32_ps(all, _mm512_maskz_cvtepu8_epi32(all, _mm_loadu_si128((const __m128i *) (model + k))));
+    d = _mm512_fmsub_ps(_mm512_loadu_ps(scale + k), q, _mm512_loadu_ps(shiftedInput + k));
+    sum = _mm512_fmadd_ps(d, d, sum);
+  }
+  float partialSums[16];
+  _mm512_storeu_ps(partialSums, sum);
+  float distance = 0;
+  for(unsigned int i = 0; i < 16; i++)
+    distance += partialSums[i];
+  return distance + byteSquaredDistanceScalar(model + k, scale + k, shiftedInput + k, size - k);
+}
+
+__attribute__((target("avx512f")))
+static void scaledRootAVX512(const float *squaredDistances, float *output, unsigned int size,
+			     float scale, float offset) {
+  __m512 s = _mm512_set1_ps(scale);
+  __m512 o = _mm512_set1_ps(offset);
+  __mmask16 all = (__mmask16) 0xffff;
+  unsigned int k = 0;
+  // the zero-masked sqrt avoids the undefined pass-through operand of _mm512_sqrt_ps,
+  // which GCC reports as possibly uninitialized
+  for(; k + 16 <= size; k += 16)
+    _mm512_storeu_ps(output + k, _mm512_fmadd_ps(s, _mm512_maskz_sqrt_ps(all, _mm512_loadu_ps(squaredDistances + k)), o));
+  scaledRootScalar(squaredDistances + k, output + k, size - k, scale, offset);
+}
+
+#endif
+
+// Fixed-size variants for the model strides of common bin counts: 24 and
+// 32 bins (stride 32), 36 bins (48) and 64 bins (64). The size argument
+// is ignored; the template parameter replaces it, so the loops have
+// constant trip counts, are unrolled completely and have no tail.
+
+template<unsigned int SIZE>
+static float squaredDistanceScalarFixed(const float *model, const float *input, unsigned int) {
+  return squaredDistanceScalar(model, input, SIZE);
+}
+
+template<unsigned int SIZE>
+static void moveTowardsScalarFixed(float *model, const float *input, unsigned int, float amount) {
+  moveTowardsScalar(model, input, SIZE, amount);
+}
+
+template<unsigned int SIZE>
+static float dotProductScalarFixed(const float *a, const float *b, unsigned int) {
+  return dotProductScalar(a, b, SIZE);
+}
+
+#ifdef SONOTOPY_X86_KERNELS
+
+template<unsigned int SIZE> __attribute__((target("sse2")))
+static float squaredDistanceSSE2Fixed(const float *model, const float *input, unsigned int) {
+  return squaredDistanceSSE2(model, input, SIZE);
+}
+
+template<unsigned int SIZE> __attribute__((target("sse2")))
+static void moveTowardsSSE2Fixed(float *model, const float *input, unsigned int, float amount) {
+  moveTowardsSSE2(model, input, SIZE, amount);
+}
+
+template<unsigned int SIZE> __attribute__((target("sse2")))
+static float dotProductSSE2Fixed(const float *a, const float *b, unsigned int) {
+  return dotProductSSE2(a, b, SIZE);
+}
+
+template<unsigned int SIZE> __attribute__((target("avx2,fma")))
+static float squaredDistanceAVX2Fixed(const float *model, const float *input, unsigned int) {
+  return squaredDistanceAVX2(model, input, SIZE);
+}
+
+template<unsigned int SIZE> __attribute__((target("avx2,fma")))
+static void moveTowardsAVX2Fixed(float *model, const float *input, unsigned int, float amount) {
+  moveTowardsAVX2(model, input, SIZE, amount);
+}
+
+template<unsigned int SIZE> __attribute__((target("avx2,fma")))
+static float dotProductAVX2Fixed(const float *a, const float *b, unsigned int) {
+  return dotProductAVX2(a, b, SIZE);
+}
+
+template<unsigned int SIZE> __attribute__((target("avx512f")))
+static float squaredDistanceAVX512Fixed(const float *model, const float *input, unsigned int) {
+  return squaredDistanceAVX512(model, input, SIZE);
+}
+
+template<unsigned int SIZE> __attribute__((target("avx512f")))
+static void moveTowardsAVX512Fixed(float *model, const float *input, unsigned int, float amount) {
+  moveTowardsAVX512(model, input, SIZE, amount);
+}
+
+template<unsigned int SIZE> __attribute__((target("avx512f")))
+static float dotProductAVX512Fixed(const float *a, const float *b, unsigned int) {
+  return dotProductAVX512(a, b, SIZE);
+}
+
+#endif
+
+template<unsigned int SIZE>
+static SOMKernels::SquaredDistanceFunction getFixedSquaredDistanceFunction(SOMKernels::InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(SOMKernels::isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SOMKernels::SSE2:
+      return squaredDistanceSSE2Fixed<SIZE>;
+    case SOMKernels::AVX2:
+      return squaredDistanceAVX2Fixed<SIZE>;
+    case SOMKernels::AVX512:
+      return squaredDistanceAVX512Fixed<SIZE>;
+    default:
+      break;
+    }
+  }
+#endif
+  return squaredDistanceScalarFixed<SIZE>;
+}
+
+template<unsigned int SIZE>
+static SOMKernels::MoveTowardsFunction getFixedMoveTowardsFunction(SOMKernels::InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(SOMKernels::isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SOMKernels::SSE2:
+      return moveTowardsSSE2Fixed<SIZE>;
+    case SOMKernels::AVX2:
+      return moveTowardsAVX2Fixed<SIZE>;
+    case SOMKernels::AVX512:
+      return moveTowardsAVX512Fixed<SIZE>;
+    default:
+      break;
+    }
+  }
+#endif
+  return moveTowardsScalarFixed<SIZE>;
+}
+
+template<unsigned int SIZE>
+static SOMKernels::DotProductFunction getFixedDotProductFunction(SOMKernels::InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(SOMKernels::isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SOMKernels::SSE2:
+      return dotProductSSE2Fixed<SIZE>;
+    case SOMKernels::AVX2:
+      return dotProductAVX2Fixed<SIZE>;
+    case SOMKernels::AVX512:
+      return dotProductAVX512Fixed<SIZE>;
+    default:
+      break;
+    }
+  }
+#endif
+  return dotProductScalarFixed<SIZE>;
+}
+
+bool SOMKernels::isSupported(InstructionSet instructionSet) {
+  switch(instructionSet) {
+  case Scalar:
+    return true;
+#ifdef SONOTOPY_X86_KERNELS
+  case SSE2:
+    return __builtin_cpu_supports("sse2");
+  case AVX2:
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  case AVX512:
+    return __builtin_cpu_supports("avx512f");
+#endif
+  default:
+    return false;
+  }
+}
+
+SOMKernels::InstructionSet SOMKernels::getBestInstructionSet() {
+  if(isSupported(AVX512))
+    return AVX512;
+  if(isSupported(AVX2))
+    return AVX2;
+  if(isSupported(SSE2))
+    return SSE2;
+  return Scalar;
+}
+
+const char *SOMKernels::getName(InstructionSet instructionSet) {
+  switch(instructionSet) {
+  case SSE2:
+    return "SSE2";
+  case AVX2:
+    return "AVX2";
+  case AVX512:
+    return "AVX-512";
+  case Scalar:
+  default:
+    return "scalar";
+  }
+}
+
+SOMKernels::SquaredDistanceFunction SOMKernels::getSquaredDistanceFunction(InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SSE2:
+      return squaredDistanceSSE2;
+    case AVX2:
+      return squaredDistanceAVX2;
+    case AVX512:
+      return squaredDistanceAVX512;
+    default:
+      break;
+    }
+  }
+#endif
+  return squaredDistanceScalar;
+}
+
+SOMKernels::MoveTowardsFunction SOMKernels::getMoveTowardsFunction(InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SSE2:
+      return moveTowardsSSE2;
+    case AVX2:
+      return moveTowardsAVX2;
+    case AVX512:
+      return moveTowardsAVX512;
+    default:
+      break;
+    }
+  }
+#endif
+  return moveTowardsScalar;
+}
+
+bool SOMKernels::hasFixedSizeKernels(unsigned int size) {
+  return size == 32 || size == 48 || size == 64;
+}
+
+SOMKernels::SquaredDistanceFunction SOMKernels::getSquaredDistanceFunction(InstructionSet instructionSet,
+									   unsigned int size) {
+  switch(size) {
+  case 32:
+    return getFixedSquaredDistanceFunction<32>(instructionSet);
+  case 48:
+    return getFixedSquaredDistanceFunction<48>(instructionSet);
+  case 64:
+    return getFixedSquaredDistanceFunction<64>(instructionSet);
+  default:
+    return getSquaredDistanceFunction(instructionSet);
+  }
+}
+
+SOMKernels::MoveTowardsFunction SOMKernels::getMoveTowardsFunction(InstructionSet instructionSet,
+								   unsigned int size) {
+  switch(size) {
+  case 32:
+    return getFixedMoveTowardsFunction<32>(instructionSet);
+  case 48:
+    return getFixedMoveTowardsFunction<48>(instructionSet);
+  case 64:
+    return getFixedMoveTowardsFunction<64>(instructionSet);
+  default:
+    return getMoveTowardsFunction(instructionSet);
+  }
+}
+
+SOMKernels::DotProductFunction SOMKernels::getDotProductFunction(InstructionSet instructionSet,
+								 unsigned int size) {
+  switch(size) {
+  case 32:
+    return getFixedDotProductFunction<32>(instructionSet);
+  case 48:
+    return getFixedDotProductFunction<48>(instructionSet);
+  case 64:
+    return getFixedDotProductFunction<64>(instructionSet);
+  default:
+    return getDotProductFunction(instructionSet);
+  }
+}
+
+SOMKernels::DotProductFunction SOMKernels::getDotProductFunction(InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SSE2:
+      return dotProductSSE2;
+    case AVX2:
+      return dotProductAVX2;
+    case AVX512:
+      return dotProductAVX512;
+    default:
+      break;
+    }
+  }
+#endif
+  return dotProductScalar;
+}
+
+SOMKernels::ScaledRootFunction SOMKernels::getScaledRootFunction(InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case SSE2:
+      return scaledRootSSE2;
+    case AVX2:
+      return scaledRootAVX2;
+    case AVX512:
+      return scaledRootAVX512;
+    default:
+      break;
+    }
+  }
+#endif
+  return scaledRootScalar;
+}
+
+// there are no SSE2 variants of the reduced precision kernels; SSE2 lacks
+// half precision conversions and widening byte loads, so they run scalar
+SOMKernels::HalfSquaredDistanceFunction SOMKernels::getHalfSquaredDistanceFunction(InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case AVX2:
+      if(__builtin_cpu_supports("f16c"))
+	return halfSquaredDistanceAVX2;
+      break;
+    case AVX512:
+      return halfSquaredDistanceAVX512;
+    default:
+      break;
+    }
+  }
+#endif
+  return halfSquaredDistanceScalar;
+}
+
+SOMKernels::ByteSquaredDistanceFunction SOMKernels::getByteSquaredDistanceFunction(InstructionSet instructionSet) {
+#ifdef SONOTOPY_X86_KERNELS
+  if(isSupported(instructionSet)) {
+    switch(instructionSet) {
+    case AVX2:
+      return byteSquaredDistanceAVX2;
+    case AVX512:
+      return byteSquaredDistanceAVX512;
+    default:
+      break;
+    }
+  }
+#endif
+  return byteSquaredDistanceScalar;
+}
+
+// round to nearest even; overflows become infinity and NaNs stay NaN
+unsigned short SOMKernels::floatToHalf(float value) {
+  unsigned int bits;
+  memcpy(&bits, &value, sizeof(bits));
+  unsigned short sign = (bits >> 16) & 0x8000;
+  unsigned int exponent = (bits >> 23) & 0xff;
+  unsigned int mantissa = bits & 0x7fffff;
+
+  if(exponent == 0xff)
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+  int halfExponent = (int) exponent - 127 + 15;
+  if(halfExponent >= 0x1f)
+    return sign | 0x7c00;
+  if(halfExponent <= 0) {
+    if(halfExponent < -10)
+      return sign;
+    // subnormal: shift the mantissa with its implicit leading one into place
+    mantissa |= 0x800000;
+    unsigned int shift = 14 - halfExponent;
+    unsigned int halfMantissa = mantissa >> shift;
+    unsigned int remainder = mantissa & ((1u << shift) - 1);
+    unsigned int halfway = 1u << (shift - 1);
+    if(remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+      halfMantissa++;
+    return sign | halfMantissa;
+  }
+  unsigned int half = (halfExponent << 10) | (mantissa >> 13);
+  unsigned int remainder = mantissa & 0x1fff;
+  if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    half++; // may carry into the exponent, which is still correct
+  return sign | half;
+}
+
+float SOMKernels::halfToFloat(unsigned short half) {
+  unsigned int sign = (half & 0x8000) << 16;
+  unsigned int exponent = (half >> 10) & 0x1f;
+  unsigned int mantissa = half & 0x3ff;
+  unsigned int bits;
+  if(exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else if(exponent == 0) {
+    if(mantissa == 0) {
+      bits = sign;
+    }
+    else {
+      // normalize the subnormal
+      exponent = 127 - 15 + 1;
+      while(!(mantissa & 0x400)) {
+	mantissa <<= 1;
+	exponent--;
+      }
+      bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+  }
+  else {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
@@ -0,0 +1,217 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "SOMSnapshot.hpp"
+#include "RectGridTopology.hpp"
+#include "CircleTopology.hpp"
+#include "DisjointGridTopology.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace sonotopy;
+using namespace std;
+
+#define MAGIC "SONOSOM"
+#define MODEL_DATA_ALIGNMENT 64
+
+namespace {
+  class Crc32Table {
+  public:
+    Crc32Table() {
+      for(uint32_t n = 0; n < 256; n++) {
+	uint32_t c = n;
+	for(int k = 0; k < 8; k++)
+	  c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+	entries[n] = c;
+      }
+    }
+    uint32_t entries[256];
+  };
+
+  const Crc32Table crc32Table;
+}
+
+uint32_t SOMSnapshot::crc32(const void *data, size_t size, uint32_t crc) {
+  const unsigned char *bytes = (const unsigned char *) data;
+  crc = ~crc;
+  for(size_t i = 0; i < size; i++)
+    crc = crc32Table.entries[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static SOMSnapshot::TopologyType getTopologyType(Topology *topology, uint32_t &width, uint32_t &height) {
+  width = topology->getNumNodes();
+  height = 1;
+  if(RectGridTopology *grid = dynamic_cast<RectGridTopology *>(topology)) {
+    width = grid->getGridWidth();
+    height = grid->getGridHeight();
+    return SOMSnapshot::RectGrid;
+  }
+  if(dynamic_cast<CircleTopology *>(topology))
+    return SOMSnapshot::Circle;
+  if(dynamic_cast<DisjointGridTopology *>(topology))
+    return SOMSnapshot::DisjointGrid;
+  return SOMSnapshot::UnknownTopology;
+}
+
+static size_t getModelDataOffset() {
+  return (sizeof(SOMSnapshot::Header) + MODEL_DATA_ALIGNMENT - 1) / MODEL_DATA_ALIGNMENT * MODEL_DATA_ALIGNMENT;
+}
+
+void SOMSnapshot::write(const SOM &som, ostream &f, const void *state, uint32_t stateSize) {
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = version;
+  header.headerSize = sizeof(Header);
+  header.topologyType = getTopologyType(som.getTopology(), header.topologyWidth, header.topologyHeight);
+  header.inputSize = som.getInputSize();
+  header.numModels = som.getNumModels();
+  header.modelStride = som.getModelStride();
+  header.modelDataOffset = getModelDataOffset();
+  size_t modelDataSize = (size_t) header.numModels * header.modelStride * sizeof(float);
+  header.stateOffset = header.modelDataOffset + modelDataSize;
+  header.stateSize = stateSize;
+  header.neighbourhoodParameter = som.getNeighbourhoodParameter();
+  header.learningParameter = som.getLearningParameter();
+
+  // the model rows are contiguous in the SOM, so the first row spans them all
+  const char padding[MODEL_DATA_ALIGNMENT] = { 0 };
+  size_t paddingSize = header.modelDataOffset - sizeof(Header);
+  const float *modelData = som.getModel(0);
+  header.checksum = crc32(padding, paddingSize);
+  header.checksum = crc32(modelData, modelDataSize, header.checksum);
+  if(stateSize > 0)
+    header.checksum = crc32(state, stateSize, header.checksum);
+  header.headerChecksum = crc32(&header, offsetof(Header, headerChecksum));
+
+  f.write((const char *) &header, sizeof(header));
+  f.write(padding, paddingSize);
+  f.write((const char *) modelData, modelDataSize);
+  if(stateSize > 0)
+    f.write((const char *) state, stateSize);
+  if(!f)
+    throw runtime_error("failed to write SOM snapshot");
+}
+
+void SOMSnapshot::write(const SOM &som, const char *filename, const void *state, uint32_t stateSize) {
+  ofstream f(filename, ios::out | ios::binary | ios::trunc);
+  if(!f)
+    throw runtime_error(string("failed to open ") + filename);
+  write(som, f, state, stateSize);
+}
+
+SOMSnapshot::SOMSnapshot(const char *filename, bool verifyChecksum) {
+  data = NULL;
+  mapped = false;
+#ifdef WIN32
+  FILE *f = fopen(filename, "rb");
+  if(!f)
+    throw runtime_error(string("failed to open ") + filename);
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(size);
+  bool read = data && fread(data, 1, size, f) == size;
+  fclose(f);
+  if(!read) {
+    free(data);
+    throw runtime_error(string("failed to read ") + filename);
+  }
+#else
+  int fd = open(filename, O_RDONLY);
+  if(fd < 0)
+    throw runtime_error(string("failed to open ") + filename);
+  struct stat status;
+  if(fstat(fd, &status) != 0 || status.st_size == 0) {
+    close(fd);
+    throw runtime_error(string("failed to read ") + filename);
+  }
+  size = status.st_size;
+  data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(data == MAP_FAILED)
+    throw runtime_error(string("failed to map ") + filename);
+  mapped = true;
+#endif
+
+  try {
+    validate(verifyChecksum);
+  }
+  catch(...) {
+#ifdef WIN32
+    free(data);
+#else
+    munmap(data, size);
+#endif
+    throw;
+  }
+}
+
+SOMSnapshot::~SOMSnapshot() {
+#ifdef WIN32
+  free(data);
+#else
+  if(mapped)
+    munmap(data, size);
+#endif
+}
+
+void SOMSnapshot::validate(bool verifyChecksum) {
+  header = (const Header *) data;
+  if(size < sizeof(Header) || memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+    throw runtime_error("not a SOM snapshot");
+  if(header->version != version || header->headerSize != sizeof(Header))
+    throw runtime_error("unsupported SOM snapshot version");
+  if(crc32(header, offsetof(Header, headerChecksum)) != header->headerChecksum)
+    throw runtime_error("corrupt SOM snapshot header");
+
+  uint64_t modelDataSize = (uint64_t) header->numModels * header->modelStride * sizeof(float);
+  if(header->modelStride < header->inputSize
+     || header->modelDataOffset < sizeof(Header)
+     || header->stateOffset != header->modelDataOffset + modelDataSize
+     || header->stateOffset + header->stateSize != size)
+    throw runtime_error("truncated or inconsistent SOM snapshot");
+
+  if(verifyChecksum && crc32((const char *) data + sizeof(Header), size - sizeof(Header)) != header->checksum)
+    throw runtime_error("SOM snapshot checksum mismatch");
+
+  models = (const float *) ((const char *) data + header->modelDataOffset);
+  state = header->stateSize > 0 ? (const char *) data + header->stateOffset : NULL;
+}
+
+void SOMSnapshot::restore(SOM &som) const {
+  uint32_t width, height;
+  TopologyType topologyType = getTopologyType(som.getTopology(), width, height);
+  if(som.getInputSize() != header->inputSize || som.getNumModels() != header->numModels
+     || topologyType != (TopologyType) header->topologyType
+     || width != header->topologyWidth || height != header->topologyHeight)
+    throw runtime_error("SOM snapshot dimensions do not match the SOM");
+  som.setModels(models, header->modelStride);
+  som.setNeighbourhoodParameter(header->neighbourhoodParameter);
+  som.setLearningParameter(header->learningParameter);
+}
@@ -37,6 +37,11 @@ void Smoother::setResponseFactor(float _responseFactor) {
     responseFactor = 1;
 }
 
-float Smoother::getValue() {
+void Smoother::setValue(float value) {
+  currentValue = value;
+  initialized = true;
+}
+
+float Smoother::getValue() const {
   return currentValue;
 }
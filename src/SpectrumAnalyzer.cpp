@@ -14,17 +14,20 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "SpectrumAnalyzer.hpp"
+#include "FFTPlanner.hpp"
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
 using namespace sonotopy;
+using namespace std;
 
 SpectrumAnalyzer::SpectrumAnalyzer(const SpectrumAnalyzerParameters &parameters) {
   windowSize = parameters.windowSize;
   windowOverlap = parameters.windowOverlap;
   powerScale = parameters.powerScale;
   windowFunction = parameters.windowFunction;
+  hopPolicy = parameters.hopPolicy;
 
   spectrumResolution = windowSize / 2;
   numUnconsumedFrames = 0;
@@ -32,12 +35,18 @@ SpectrumAnalyzer::SpectrumAnalyzer(const SpectrumAnalyzerParameters &parameters)
 
   dB_defaultReference = 0.00001;
 
-  inputHistoryBuffer = (float *) malloc(sizeof(float) * windowSize);
-  inputHistory = new CircularBuffer<float> (windowSize);
-  fftIn = (fftw_complex *) malloc(sizeof(fftw_complex) * windowSize);
-  fftOut = (fftw_complex *) malloc(sizeof(fftw_complex) * windowSize);
-  fftPlan = fftw_plan_dft_1d(windowSize, fftIn, fftOut, FFTW_DHT, FFTW_MEASURE);
+  // room for the frames of an incomplete hop after the newest window; the
+  // readhead stays at the start of the window
+  inputHistory = new MirroredCircularBuffer<float> (windowSize + numNewFramesPerFFT);
+  inputHistory->moveReadHead(numNewFramesPerFFT);
+  fftIn = fftwf_alloc_real(windowSize);
+  fftOut = fftwf_alloc_complex(windowSize / 2 + 1);
+  fftPlan = FFTPlanner::getRealPlan(windowSize);
   spectrum = (float *) malloc(sizeof(float) * spectrumResolution);
+  memset(spectrum, 0, sizeof(float) * spectrumResolution);
+  if(hopPolicy == LatestHopOnly)
+    hopSpectra.push_back(spectrum);
+  numHopSpectra = 0;
 
   if(powerScale == dB) {
     setDecibelReference(dB_defaultReference);
@@ -53,11 +62,14 @@ SpectrumAnalyzer::SpectrumAnalyzer(const SpectrumAnalyzerParameters &parameters)
 }
 
 SpectrumAnalyzer::~SpectrumAnalyzer() {
-  free(inputHistoryBuffer);
   delete inputHistory;
-  free(fftIn);
-  free(fftOut);
+  fftwf_free(fftIn);
+  fftwf_free(fftOut);
   free(spectrum);
+  if(hopPolicy == EveryHop) {
+    for(vector<float *>::iterator i = hopSpectra.begin(); i != hopSpectra.end(); ++i)
+      free(*i);
+  }
   if(windowFunction != NoWindowFunction)
     delete [] windowFunctionTable;
 }
@@ -69,17 +81,67 @@ void SpectrumAnalyzer::setDecibelReference(double _dB_reference) {
   log10_scalefactor = log10_max - log10_min;
 }
 
+void SpectrumAnalyzer::setSpectrumSupport(const vector<unsigned int> &positions) {
+  spectrumSupport = positions;
+  clearSpectra();
+}
+
+void SpectrumAnalyzer::clearSpectra() {
+  memset(spectrum, 0, sizeof(float) * spectrumResolution);
+  if(hopPolicy == EveryHop) {
+    for(vector<float *>::iterator i = hopSpectra.begin(); i != hopSpectra.end(); ++i)
+      memset(*i, 0, sizeof(float) * spectrumResolution);
+  }
+}
+
 void SpectrumAnalyzer::feedAudioFrames(const float *inputBuffer, unsigned long numFrames) {
-  appendAudioToHistory(inputBuffer, numFrames);
-  processUnconsumedFrames();
+  numHopSpectra = 0;
+  if(hopPolicy == EveryHop) {
+    feedAudioFramesHopByHop(inputBuffer, numFrames);
+  }
+  else {
+    appendAudioToHistory(inputBuffer, numFrames);
+    processUnconsumedFrames();
+  }
 }
 
 void SpectrumAnalyzer::processUnconsumedFrames() {
-  while(numUnconsumedFrames >= numNewFramesPerFFT) {
-    inputHistory->moveReadHead(numNewFramesPerFFT);
-    numUnconsumedFrames -= numNewFramesPerFFT;
-    performFFT();
+  // superseded windows are skipped by moving the readhead past all complete hops at once
+  unsigned long numHops = numUnconsumedFrames / numNewFramesPerFFT;
+  if(numHops > 0) {
+    inputHistory->moveReadHead(numHops * numNewFramesPerFFT);
+    numUnconsumedFrames -= numHops * numNewFramesPerFFT;
+    performFFT(spectrum);
+    numHopSpectra = 1;
+  }
+}
+
+void SpectrumAnalyzer::feedAudioFramesHopByHop(const float *inputBuffer, unsigned long numFrames) {
+  // the history only holds one window, so each hop is transformed before
+  // the next one is appended
+  while(numFrames > 0) {
+    unsigned long numHopFrames = numNewFramesPerFFT - numUnconsumedFrames;
+    if(numHopFrames > numFrames)
+      numHopFrames = numFrames;
+    appendAudioToHistory(inputBuffer, numHopFrames);
+    inputBuffer += numHopFrames;
+    numFrames -= numHopFrames;
+    if(numUnconsumedFrames == numNewFramesPerFFT) {
+      inputHistory->moveReadHead(numNewFramesPerFFT);
+      numUnconsumedFrames = 0;
+      performFFT(getNextHopSpectrum());
+    }
+  }
+  if(numHopSpectra > 0)
+    memcpy(spectrum, hopSpectra[numHopSpectra - 1], sizeof(float) * spectrumResolution);
+}
+
+float *SpectrumAnalyzer::getNextHopSpectrum() {
+  if(numHopSpectra == hopSpectra.size()) {
+    hopSpectra.push_back((float *) malloc(sizeof(float) * spectrumResolution));
+    memset(hopSpectra.back(), 0, sizeof(float) * spectrumResolution);
   }
+  return hopSpectra[numHopSpectra++];
 }
 
 void SpectrumAnalyzer::appendAudioToHistory(const float *inputBuffer, unsigned long numFrames) {
@@ -87,35 +149,32 @@ void SpectrumAnalyzer::appendAudioToHistory(const float *inputBuffer, unsigned l
   numUnconsumedFrames += numFrames;
 }
 
-void SpectrumAnalyzer::performFFT() {
+void SpectrumAnalyzer::performFFT(float *destination) {
   inputHistoryToFftIn();
-  fftw_execute(fftPlan);
-  fftOutToSpectrum();
+  fftwf_execute_dft_r2c(fftPlan, fftIn, fftOut);
+  if(isSparse())
+    fftOutToSparseSpectrum(destination);
+  else
+    fftOutToSpectrum(destination);
 }
 
 void SpectrumAnalyzer::inputHistoryToFftIn() {
-  inputHistory->read(windowSize, inputHistoryBuffer);
-  float *inputPtr = inputHistoryBuffer;
-  fftw_complex *fftInPtr = fftIn;
-  for(int i = 0; i < windowSize; i++) {
-    (*fftInPtr)[0] = *inputPtr++;
-    (*fftInPtr)[1] = 0;
-    fftInPtr++;
-  }
+  const float *window = inputHistory->getReadPointer();
   if(windowFunction != NoWindowFunction) {
-    double *tableP = windowFunctionTable;
-    fftInPtr = fftIn;
-    for(int i = 0; i < windowSize; i++) {
-      (*fftInPtr)[0] *= (*tableP);
-      fftInPtr++;
-      tableP++;
-    }
+    const float *inputPtr = window;
+    const float *tableP = windowFunctionTable;
+    float *fftInPtr = fftIn;
+    for(int i = 0; i < windowSize; i++)
+      *fftInPtr++ = *inputPtr++ * *tableP++;
+  }
+  else {
+    memcpy(fftIn, window, sizeof(float) * windowSize);
   }
 }
 
-void SpectrumAnalyzer::fftOutToSpectrum() {
-  fftw_complex *fftOutPtr = fftOut;
-  float *spectrumPtr = spectrum;
+void SpectrumAnalyzer::fftOutToSpectrum(float *destination) {
+  fftwf_complex *fftOutPtr = fftOut;
+  float *spectrumPtr = destination;
   double r, c;
   for(unsigned long i = 0; i < spectrumResolution; i++) {
     r = (*fftOutPtr)[0];
@@ -125,6 +184,15 @@ void SpectrumAnalyzer::fftOutToSpectrum() {
   }
 }
 
+void SpectrumAnalyzer::fftOutToSparseSpectrum(float *destination) {
+  double r, c;
+  for(vector<unsigned int>::iterator k = spectrumSupport.begin(); k != spectrumSupport.end(); k++) {
+    r = fftOut[*k][0];
+    c = fftOut[*k][1];
+    destination[*k] = (float) (this->*scalePower)(r*r+c*c);
+  }
+}
+
 double SpectrumAnalyzer::powerToAmplitude(double x) {
   return sqrt(x) / fftOutMax;
 }
@@ -136,8 +204,8 @@ double SpectrumAnalyzer::powerToDB(double x) {
 
 void SpectrumAnalyzer::createBlackmanHarrisWindowFunctionTable() {
   // GNUPLOT: plot [0:(N-1)] N=1024, 0.35875-0.48829*cos(2*pi*x/(N-1))+0.14128*cos(4*pi*x/(N-1))-0.01168*cos(6*pi*x/(N-1));
-  windowFunctionTable = new double [windowSize];
-  double *tableP = windowFunctionTable;
+  windowFunctionTable = new float [windowSize];
+  float *tableP = windowFunctionTable;
   for(int x = 0; x < windowSize; x++) {
     *tableP =
       0.35875
@@ -141,6 +141,15 @@ void SpectrumBinDivider::createSpectrumPositions() {
     }
     binPtr++;
   }
+
+  for(unsigned int pos = 0; pos < spectrumResolution; pos++) {
+    if(!spectrumPositions[pos].binConnections.empty())
+      spectrumSupport.push_back(pos);
+  }
+}
+
+void SpectrumBinDivider::setBinValues(const float *values) {
+  memcpy(binValues, values, sizeof(float) * numBins);
 }
 
 void SpectrumBinDivider::setIntegrationTimeMs(float _integrationTimeMs) {
@@ -162,22 +171,21 @@ void SpectrumBinDivider::clearBinPowerSums() {
 }
 
 void SpectrumBinDivider::accummulateBinPowerSumsFromSpectrum(const float *spectrum) {
-  const float *spectrumPtr = spectrum;
   float power;
-  SpectrumPosition *spectrumPositionPtr = spectrumPositions;
+  SpectrumPosition *spectrumPositionPtr;
   std::vector<BinConnection>::iterator binConnectionsBegin, binConnectionsEnd, c;
+  std::vector<unsigned int>::iterator pos;
   Bin *targetBin;
 
-  for(unsigned int i = 0; i < spectrumResolution; i++) {
-    power = *spectrumPtr;
+  for(pos = spectrumSupport.begin(); pos != spectrumSupport.end(); pos++) {
+    power = spectrum[*pos];
+    spectrumPositionPtr = spectrumPositions + *pos;
     binConnectionsBegin = spectrumPositionPtr->binConnections.begin();
     binConnectionsEnd = spectrumPositionPtr->binConnections.end();
     for(c = binConnectionsBegin; c != binConnectionsEnd; c++) {
       targetBin = c->targetBin;
       targetBin->powerSum += power * c->strength;
     }
-    spectrumPositionPtr++;
-    spectrumPtr++;
   }
 }
 
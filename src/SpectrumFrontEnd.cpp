@@ -0,0 +1,52 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "SpectrumFrontEnd.hpp"
+#include <algorithm>
+
+using namespace sonotopy;
+using namespace std;
+
+SpectrumFrontEnd::SpectrumFrontEnd(const AudioParameters &_audioParameters,
+				   const SpectrumAnalyzerParameters &spectrumAnalyzerParameters) {
+  audioParameters = _audioParameters;
+  spectrumAnalyzer = new SpectrumAnalyzer(spectrumAnalyzerParameters);
+  spectrumBinDivider = new SpectrumBinDivider(audioParameters.sampleRate,
+					      spectrumAnalyzer->getSpectrumResolution());
+  if(spectrumAnalyzerParameters.sparseSpectrum)
+    spectrumAnalyzer->setSpectrumSupport(spectrumBinDivider->getSpectrumSupport());
+}
+
+SpectrumFrontEnd::~SpectrumFrontEnd() {
+  delete spectrumBinDivider;
+  delete spectrumAnalyzer;
+}
+
+void SpectrumFrontEnd::feedAudio(const float *audio, unsigned long numFrames) {
+  spectrumAnalyzer->feedAudioFrames(audio, numFrames);
+  spectrumBinDivider->feedSpectrum(spectrumAnalyzer->getSpectrum(), numFrames);
+  for(vector<Consumer *>::iterator i = consumers.begin(); i != consumers.end(); ++i)
+    (*i)->feedAnalysis(this, numFrames);
+}
+
+void SpectrumFrontEnd::attach(Consumer *consumer) {
+  if(find(consumers.begin(), consumers.end(), consumer) == consumers.end())
+    consumers.push_back(consumer);
+}
+
+void SpectrumFrontEnd::detach(Consumer *consumer) {
+  consumers.erase(remove(consumers.begin(), consumers.end(), consumer), consumers.end());
+}
@@ -14,7 +14,10 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "SpectrumMap.hpp"
+#include "SOMSnapshot.hpp"
 #include <math.h>
+#include <stdexcept>
+#include <string.h>
 
 using namespace sonotopy;
 using namespace std;
@@ -28,14 +31,37 @@ SpectrumMap::SpectrumMap(Topology *_topology,
   audioParameters = _audioParameters;
   spectrumMapParameters = _spectrumMapParameters;
 
+  frontEnd = NULL;
   createSpectrumAnalyzer(spectrumAnalyzerParameters);
   createSpectrumBinDivider();
+  if(spectrumAnalyzerParameters.sparseSpectrum)
+    spectrumAnalyzer->setSpectrumSupport(spectrumBinDivider->getSpectrumSupport());
+  initialize();
+}
+
+SpectrumMap::SpectrumMap(Topology *_topology,
+			 SpectrumFrontEnd *_frontEnd,
+			 const SpectrumMapParameters &_spectrumMapParameters)
+{
+  topology = _topology;
+  frontEnd = _frontEnd;
+  audioParameters = frontEnd->getAudioParameters();
+  spectrumMapParameters = _spectrumMapParameters;
+
+  spectrumAnalyzer = frontEnd->getSpectrumAnalyzer();
+  spectrumBinDivider = frontEnd->getSpectrumBinDivider();
+  spectrumResolution = spectrumBinDivider->getNumBins();
+  initialize();
+  frontEnd->attach(this);
+}
+
+void SpectrumMap::initialize() {
   createSom();
   createSomInput();
-  createSomOutput();
 
   previousCursorUpdateTimeSecs = 0.0f;
   activationPatternOutdated = false;
+  framePublisher = NULL;
 
   if(spectrumMapParameters.adaptationStrategy == SpectrumMapParameters::ErrorDriven) {
     errorLevel = spectrumMapParameters.errorThresholdHigh;
@@ -47,9 +73,14 @@ SpectrumMap::SpectrumMap(Topology *_topology,
 }
 
 SpectrumMap::~SpectrumMap() {
+  delete framePublisher;
   delete som;
-  delete spectrumBinDivider;
-  delete spectrumAnalyzer;
+  if(frontEnd)
+    frontEnd->detach(this);
+  else {
+    delete spectrumBinDivider;
+    delete spectrumAnalyzer;
+  }
   delete currentActivationPattern;
   delete nextActivationPattern;
 }
@@ -64,6 +95,9 @@ SpectrumMapParameters SpectrumMap::getSpectrumMapParameters() const {
 
 void SpectrumMap::createSom() {
   som = new SOM(spectrumResolution, topology);
+  som->setNumThreads(spectrumMapParameters.numThreads);
+  if(spectrumMapParameters.randomSeed)
+    som->setRandomSeed(spectrumMapParameters.randomSeed);
   currentActivationPattern = som->createActivationPattern();
   nextActivationPattern = som->createActivationPattern();
   resetAdaptation();
@@ -87,16 +121,50 @@ void SpectrumMap::resetAdaptation() {
   elapsedTimeSecs = 0.0f;
 }
 
+// adaptation state stored in a snapshot after the models, followed by the bin values
+typedef struct {
+  uint32_t numBins;
+  float elapsedTimeSecs;
+  float errorLevel;
+  uint32_t errorLevelSmootherInitialized;
+  float errorLevelSmootherValue;
+} SnapshotState;
+
+void SpectrumMap::writeSnapshot(const char *filename) const {
+  unsigned int numBins = spectrumBinDivider->getNumBins();
+  vector<char> state(sizeof(SnapshotState) + sizeof(float) * numBins);
+  SnapshotState *header = (SnapshotState *) &state[0];
+  header->numBins = numBins;
+  header->elapsedTimeSecs = elapsedTimeSecs;
+  header->errorLevel = errorLevel;
+  header->errorLevelSmootherInitialized = errorLevelSmoother.isInitialized();
+  header->errorLevelSmootherValue = errorLevelSmoother.isInitialized() ? errorLevelSmoother.getValue() : 0;
+  memcpy(&state[sizeof(SnapshotState)], spectrumBinDivider->getBinValues(), sizeof(float) * numBins);
+  SOMSnapshot::write(*som, filename, &state[0], state.size());
+}
+
+void SpectrumMap::restoreSnapshot(const char *filename) {
+  SOMSnapshot snapshot(filename);
+  const SnapshotState *state = (const SnapshotState *) snapshot.getState();
+  unsigned int numBins = spectrumBinDivider->getNumBins();
+  if(snapshot.getStateSize() != sizeof(SnapshotState) + sizeof(float) * numBins
+     || state->numBins != numBins)
+    throw runtime_error("snapshot does not hold the state of a matching spectrum map");
+  snapshot.restore(*som);
+  elapsedTimeSecs = state->elapsedTimeSecs;
+  errorLevel = state->errorLevel;
+  if(state->errorLevelSmootherInitialized)
+    errorLevelSmoother.setValue(state->errorLevelSmootherValue);
+  if(!frontEnd) // a shared bin divider keeps integrating for all maps on the front end
+    spectrumBinDivider->setBinValues((const float *) (state + 1));
+  previousCursorUpdateTimeSecs = 0.0f;
+}
+
 void SpectrumMap::createSomInput() {
   for(int i = 0; i < spectrumResolution; i++)
     somInput.push_back(0);
 }
 
-void SpectrumMap::createSomOutput() {
-  for(unsigned int i = 0; i < topology->getNumNodes(); i++)
-    somOutput.push_back(0);
-}
-
 const SOM::ActivationPattern* SpectrumMap::getActivationPattern() {
   if(activationPatternOutdated) {
     som->getActivationPattern(nextActivationPattern);
@@ -117,20 +185,93 @@ void SpectrumMap::createSpectrumBinDivider() {
 }
 
 void SpectrumMap::feedAudio(const float *audio, unsigned long numFrames) {
+  if(frontEnd)
+    throw runtime_error("spectrum map is fed by its front end");
   spectrumAnalyzer->feedAudioFrames(audio, numFrames);
+  spectrumBinDivider->feedSpectrum(spectrumAnalyzer->getSpectrum(), numFrames);
+  trainOnBinValues(numFrames);
+}
+
+void SpectrumMap::feedAnalysis(const SpectrumFrontEnd *, unsigned long numFrames) {
+  trainOnBinValues(numFrames);
+}
+
+void SpectrumMap::trainOnBinValues(unsigned long numFrames) {
   spectrum = spectrumAnalyzer->getSpectrum();
-  spectrumBinDivider->feedSpectrum(spectrum, numFrames);
   spectrumBinValues = spectrumBinDivider->getBinValues();
   setTrainingParameters(numFrames);
   feedSpectrumToSom(spectrumBinValues);
   elapsedTimeSecs += (float) numFrames / audioParameters.sampleRate;
   activationPatternOutdated = true;
+  if(framePublisher)
+    publishFrame();
+}
+
+void SpectrumMap::feedAudioBlock(const float *audio, unsigned long numFrames) {
+  if(frontEnd)
+    throw runtime_error("spectrum map is fed by its front end");
+  if(numFrames == 0)
+    return;
+  unsigned long hopSize = audioParameters.bufferSize;
+  unsigned long numHops = (numFrames + hopSize - 1) / hopSize;
+  somInputBatch.resize(numHops);
+  for(unsigned long hop = 0; hop < numHops; hop++) {
+    unsigned long numHopFrames = hop == numHops - 1 ? numFrames - hop * hopSize : hopSize;
+    spectrumAnalyzer->feedAudioFrames(audio + hop * hopSize, numHopFrames);
+    spectrum = spectrumAnalyzer->getSpectrum();
+    spectrumBinDivider->feedSpectrum(spectrum, numHopFrames);
+    spectrumBinValues = spectrumBinDivider->getBinValues();
+    spectrumToSomInput(spectrumBinValues);
+    somInputBatch[hop] = somInput;
+    if(hop < numHops - 1)
+      elapsedTimeSecs += (float) numHopFrames / audioParameters.sampleRate;
+  }
+
+  // the training parameters of the last hop apply to the whole batch
+  setTrainingParameters(numFrames - (numHops - 1) * hopSize);
+  som->trainBatch(somInputBatch);
+  if(spectrumMapParameters.adaptationStrategy == SpectrumMapParameters::ErrorDriven)
+    errorLevel = errorLevelSmoother.smooth(getErrorMax());
+  elapsedTimeSecs += (float) (numFrames - (numHops - 1) * hopSize) / audioParameters.sampleRate;
+  activationPatternOutdated = true;
+  if(framePublisher)
+    publishFrame();
+}
+
+void SpectrumMap::setFramePublication(bool enabled, unsigned int numBuffers) {
+  delete framePublisher;
+  framePublisher = NULL;
+  if(enabled) {
+    framePublisher = new Publisher<Frame>(numBuffers);
+    for(unsigned int i = 0; i < framePublisher->getNumBuffers(); i++)
+      framePublisher->getBuffer(i).activationPattern.resize(currentActivationPattern->size());
+  }
+}
+
+const SpectrumMap::Frame *SpectrumMap::acquireFrame() {
+  return framePublisher ? framePublisher->acquire() : NULL;
+}
+
+void SpectrumMap::releaseFrame(const Frame *frame) {
+  if(framePublisher)
+    framePublisher->release(frame);
+}
+
+void SpectrumMap::publishFrame() {
+  Frame *frame = framePublisher->beginPublication();
+  if(!frame)
+    return;
+  som->getActivationPattern(&frame->activationPattern);
+  frame->winnerId = getWinnerId();
+  moveTopologyCursorTowardsWinner();
+  getCursorPosition(frame->cursorX, frame->cursorY);
+  frame->elapsedTimeSecs = elapsedTimeSecs;
+  framePublisher->endPublication();
 }
 
 void SpectrumMap::feedSpectrumToSom(const float *spectrum) {
   spectrumToSomInput(spectrum);
   som->train(somInput);
-  som->getLastOutput(somOutput);
   if(spectrumMapParameters.adaptationStrategy == SpectrumMapParameters::ErrorDriven)
     errorLevel = errorLevelSmoother.smooth(getErrorMax());
 }
@@ -254,7 +395,7 @@ void SpectrumMap::writeActivationPattern(ofstream &f) {
   float v;
   for(unsigned int i = 0; i < topology->getNumNodes(); i++) {
     v = *activationPatternIterator++;
-    f << v << endl;
+    f << v << '\n';
   }
 }
 
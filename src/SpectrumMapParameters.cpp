@@ -20,6 +20,8 @@ using namespace sonotopy;
 SpectrumMapParameters::SpectrumMapParameters() {
   trajectorySmoothness = 0.1f;
   adaptationStrategy = TimeBased;
+  numThreads = 1;
+  randomSeed = 0;
 
   // parameters for time-based adaptation
   initialNeighbourhoodParameter = 1.0f;
@@ -0,0 +1,122 @@
+// Copyright (C) 2011 Alexander Berman
+//
+// Sonotopy is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "ThreadPool.hpp"
+#include <cassert>
+
+using namespace sonotopy;
+
+ThreadPool::ThreadPool(unsigned int _numThreads) {
+  assert(_numThreads != 0);
+  numThreads = _numThreads;
+  generation = 0;
+  numPendingChunks = 0;
+  stopping = false;
+  task = NULL;
+  numItems = 0;
+  numChunks = 0;
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&taskAvailable, NULL);
+  pthread_cond_init(&taskCompleted, NULL);
+
+  workers.resize(numThreads - 1);
+  workerContexts.resize(numThreads - 1);
+  for(unsigned int i = 0; i < numThreads - 1; i++) {
+    workerContexts[i].pool = this;
+    workerContexts[i].index = i + 1;
+    pthread_create(&workers[i], NULL, workerMain, &workerContexts[i]);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  pthread_mutex_lock(&mutex);
+  stopping = true;
+  pthread_cond_broadcast(&taskAvailable);
+  pthread_mutex_unlock(&mutex);
+  for(std::vector<pthread_t>::iterator i = workers.begin(); i != workers.end(); ++i)
+    pthread_join(*i, NULL);
+  pthread_cond_destroy(&taskCompleted);
+  pthread_cond_destroy(&taskAvailable);
+  pthread_mutex_destroy(&mutex);
+}
+
+unsigned int ThreadPool::getNumChunks(unsigned int numItems, unsigned int minItemsPerChunk) const {
+  if(minItemsPerChunk == 0)
+    minItemsPerChunk = 1;
+  unsigned int n = numItems / minItemsPerChunk;
+  if(n > numThreads)
+    return numThreads;
+  if(n == 0)
+    return 1;
+  return n;
+}
+
+void ThreadPool::run(Task &_task, unsigned int _numItems, unsigned int minItemsPerChunk) {
+  unsigned int _numChunks = getNumChunks(_numItems, minItemsPerChunk);
+  if(_numChunks == 1) {
+    _task.run(0, 0, _numItems);
+    return;
+  }
+
+  pthread_mutex_lock(&mutex);
+  task = &_task;
+  numItems = _numItems;
+  numChunks = _numChunks;
+  numPendingChunks = numChunks - 1;
+  generation++;
+  pthread_cond_broadcast(&taskAvailable);
+  pthread_mutex_unlock(&mutex);
+
+  runChunk(0);
+
+  pthread_mutex_lock(&mutex);
+  while(numPendingChunks > 0)
+    pthread_cond_wait(&taskCompleted, &mutex);
+  task = NULL;
+  pthread_mutex_unlock(&mutex);
+}
+
+void ThreadPool::runChunk(unsigned int chunk) {
+  unsigned int begin = (unsigned int) ((unsigned long long) numItems * chunk / numChunks);
+  unsigned int end = (unsigned int) ((unsigned long long) numItems * (chunk + 1) / numChunks);
+  task->run(chunk, begin, end);
+}
+
+void *ThreadPool::workerMain(void *arg) {
+  WorkerContext *context = (WorkerContext *) arg;
+  context->pool->work(context->index);
+  return NULL;
+}
+
+void ThreadPool::work(unsigned int workerIndex) {
+  unsigned long seenGeneration = 0;
+  pthread_mutex_lock(&mutex);
+  while(true) {
+    while(!stopping && generation == seenGeneration)
+      pthread_cond_wait(&taskAvailable, &mutex);
+    if(stopping)
+      break;
+    seenGeneration = generation;
+    if(workerIndex < numChunks) {
+      pthread_mutex_unlock(&mutex);
+      runChunk(workerIndex);
+      pthread_mutex_lock(&mutex);
+      if(--numPendingChunks == 0)
+        pthread_cond_signal(&taskCompleted);
+    }
+  }
+  pthread_mutex_unlock(&mutex);
+}
@@ -14,28 +14,208 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Topology.hpp"
+#include <algorithm>
 
 using namespace sonotopy;
 
+// sorted distance tables take numNodes^2 entries of 8 bytes (8 MB at the
+// limit), so they are only kept for smaller topologies
+#define MAX_NODES_WITH_DISTANCE_TABLES 1024
+#define NO_LEVEL ((unsigned int) -1)
+#define DEFAULT_NUM_ADJACENT_NODES 8
+// per-pair distance tables take numNodes^2 floats
+#define MAX_NODES_WITH_PAIR_DISTANCES 1024
+
+Topology::Topology() {
+  vicinityFactor = 0;
+  vicinityLevel = 0;
+  stencilLevel = NO_LEVEL;
+  hasStencil = false;
+  distanceTableType = DistanceTableNotCreated;
+  numPairDistanceNodes = 0;
+}
+
+void Topology::createDistanceTable() {
+  unsigned int numNodes = getNumNodes();
+  if(buildOffsetDistanceTable(offsetDistanceTable)) {
+    distanceTableType = OffsetDistances;
+  }
+  else if(numNodes <= MAX_NODES_WITH_PAIR_DISTANCES) {
+    pairDistances.resize(numNodes * numNodes);
+    numPairDistanceNodes = numNodes;
+    for(unsigned int source = 0; source < numNodes; source++)
+      for(unsigned int target = 0; target < numNodes; target++)
+        pairDistances[source * numNodes + target] = getDistance(source, target);
+    distanceTableType = PairDistances;
+  }
+  else {
+    distanceTableType = NoDistanceTable;
+  }
+}
+
 void Topology::setVicinityFactor(float _vicinityFactor) {
-  vicinityFactor = _vicinityFactor;
+  if(_vicinityFactor < 0)
+    _vicinityFactor = 0;
+  vicinityLevel = (unsigned int) (_vicinityFactor * numVicinityLevels + 0.5f);
+  vicinityFactor = (float) vicinityLevel / numVicinityLevels;
 }
 
 void Topology::getNeighbours(unsigned int nodeId, std::vector<Neighbour> &neighbours) {
+  neighbours = getNeighbours(nodeId);
+}
+
+const std::vector<Topology::Neighbour> &Topology::getNeighbours(unsigned int nodeId) {
+  if(cachedNeighbours.size() != getNumNodes())
+    createCaches();
+  std::vector<Neighbour> &neighbours = cachedNeighbours[nodeId];
+  if(cachedNeighboursLevel[nodeId] != vicinityLevel) {
+    if(neighbours.capacity() > 4 * neighbours.size() + 16)
+      std::vector<Neighbour>().swap(neighbours); // release memory from a larger neighbourhood
+    findNeighbours(nodeId, neighbours);
+    cachedNeighboursLevel[nodeId] = vicinityLevel;
+  }
+  return neighbours;
+}
+
+void Topology::createCaches() {
+  unsigned int numNodes = getNumNodes();
+  cachedNeighbours.clear();
+  cachedNeighbours.resize(numNodes);
+  cachedNeighboursLevel.assign(numNodes, NO_LEVEL);
+  nodesByDistance.clear();
+  if(numNodes <= MAX_NODES_WITH_DISTANCE_TABLES)
+    nodesByDistance.resize(numNodes);
+}
+
+const Topology::Stencil *Topology::getStencil() {
+  if(stencilLevel != vicinityLevel) {
+    stencil.rows.clear();
+    hasStencil = buildStencil(stencil);
+    stencilLevel = vicinityLevel;
+  }
+  return hasStencil ? &stencil : NULL;
+}
+
+void Topology::stencilToNeighbours(const Stencil &stencil, unsigned int nodeId,
+                                   std::vector<Neighbour> &neighbours) {
+  int x = nodeId % stencil.width;
+  int y = nodeId / stencil.width;
+  int width = stencil.width;
+  int height = stencil.height;
+  int neighbourX, neighbourY;
+  Neighbour neighbour;
+  for(std::vector<StencilRow>::const_iterator row = stencil.rows.begin(); row != stencil.rows.end(); ++row) {
+    neighbourY = y + row->dy;
+    if(neighbourY < 0 || neighbourY >= height)
+      continue;
+    for(unsigned int i = 0; i < row->strengths.size(); i++) {
+      int dx = row->dxMin + (int) i;
+      if(dx == 0 && row->dy == 0)
+        continue;
+      neighbourX = x + dx;
+      if(stencil.wrapAround)
+        neighbourX = ((neighbourX % width) + width) % width;
+      else if(neighbourX < 0 || neighbourX >= width)
+        continue;
+      neighbour.nodeId = neighbourY * width + neighbourX;
+      neighbour.strength = row->strengths[i];
+      neighbours.push_back(neighbour);
+    }
+  }
+}
+
+void Topology::findNeighbours(unsigned int nodeId, std::vector<Neighbour> &neighbours) {
   neighbours.clear();
   if(vicinityFactor > 0) {
-    unsigned int numNodes = getNumNodes();
-    float distance;
     Neighbour neighbour;
+    const Stencil *stencil = getStencil();
+    if(stencil) {
+      stencilToNeighbours(*stencil, nodeId, neighbours);
+    }
+    else if(nodesByDistance.empty()) {
+      unsigned int numNodes = getNumNodes();
+      float distance;
+      for(unsigned int neighbourId = 0; neighbourId < numNodes; neighbourId++) {
+        if(neighbourId != nodeId) {
+          distance = lookupDistance(nodeId, neighbourId);
+          if(distance < vicinityFactor) {
+            neighbour.nodeId = neighbourId;
+            neighbour.strength = (float) (vicinityFactor - distance) / vicinityFactor;
+            neighbours.push_back(neighbour);
+          }
+        }
+      }
+    }
+    else {
+      const std::vector<NodeDistance> &nodes = getNodesByDistance(nodeId);
+      for(std::vector<NodeDistance>::const_iterator i = nodes.begin();
+          i != nodes.end() && i->distance < vicinityFactor; ++i) {
+        neighbour.nodeId = i->nodeId;
+        neighbour.strength = (float) (vicinityFactor - i->distance) / vicinityFactor;
+        neighbours.push_back(neighbour);
+      }
+    }
+  }
+}
+
+const std::vector<unsigned int> &Topology::getAdjacentNodes(unsigned int nodeId) {
+  if(adjacentNodes.size() != getNumNodes())
+    adjacentNodes.assign(getNumNodes(), std::vector<unsigned int>());
+  std::vector<unsigned int> &nodes = adjacentNodes[nodeId];
+  if(nodes.empty() && getNumNodes() > 1)
+    findAdjacentNodes(nodeId, nodes);
+  return nodes;
+}
+
+// by default, the nodes nearest to a node are considered adjacent to it
+void Topology::findAdjacentNodes(unsigned int nodeId, std::vector<unsigned int> &nodes) {
+  unsigned int numNodes = getNumNodes();
+  unsigned int numAdjacentNodes = numNodes - 1 < DEFAULT_NUM_ADJACENT_NODES ?
+    numNodes - 1 : DEFAULT_NUM_ADJACENT_NODES;
+  nodes.clear();
+  if(cachedNeighbours.size() != numNodes)
+    createCaches();
+  if(!nodesByDistance.empty()) {
+    const std::vector<NodeDistance> &nearest = getNodesByDistance(nodeId);
+    for(unsigned int i = 0; i < numAdjacentNodes; i++)
+      nodes.push_back(nearest[i].nodeId);
+  }
+  else {
+    std::vector<NodeDistance> candidates;
+    NodeDistance candidate;
+    candidates.reserve(numNodes - 1);
+    for(unsigned int id = 0; id < numNodes; id++) {
+      if(id != nodeId) {
+        candidate.distance = lookupDistance(nodeId, id);
+        candidate.nodeId = id;
+        candidates.push_back(candidate);
+      }
+    }
+    std::partial_sort(candidates.begin(), candidates.begin() + numAdjacentNodes,
+                      candidates.end(), compareNodeDistances);
+    for(unsigned int i = 0; i < numAdjacentNodes; i++)
+      nodes.push_back(candidates[i].nodeId);
+  }
+}
+
+const std::vector<Topology::NodeDistance> &Topology::getNodesByDistance(unsigned int nodeId) {
+  std::vector<NodeDistance> &nodes = nodesByDistance[nodeId];
+  if(nodes.empty()) {
+    unsigned int numNodes = getNumNodes();
+    NodeDistance node;
+    nodes.reserve(numNodes - 1);
     for(unsigned int neighbourId = 0; neighbourId < numNodes; neighbourId++) {
       if(neighbourId != nodeId) {
-        distance = getDistance(nodeId, neighbourId);
-        if(distance < vicinityFactor) {
-          neighbour.nodeId = neighbourId;
-          neighbour.strength = (float) (vicinityFactor - distance) / vicinityFactor;
-          neighbours.push_back(neighbour);
-        }
+        node.distance = lookupDistance(nodeId, neighbourId);
+        node.nodeId = neighbourId;
+        nodes.push_back(node);
       }
     }
+    std::stable_sort(nodes.begin(), nodes.end(), compareNodeDistances);
   }
+  return nodes;
+}
+
+bool Topology::compareNodeDistances(const NodeDistance &a, const NodeDistance &b) {
+  return a.distance < b.distance;
 }
@@ -14,17 +14,28 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "AudioIO.hpp"
+#include <sonotopy/Stopwatch.hpp>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+using namespace sonotopy;
 
 AudioIO::AudioIO() {
   monauralInputBuffer = NULL;
   audioFileBuffer = NULL;
   audioDeviceName = NULL;
   videoExportEnabled = false;
+  processingThreadEnabled = false;
+  processingThreadRunning = false;
+  audioBlockQueue = NULL;
+  processingBuffer = NULL;
 }
 
 AudioIO::~AudioIO() {
+  stopProcessingThread();
+  if(audioBlockQueue) delete audioBlockQueue;
+  if(processingBuffer) delete [] processingBuffer;
   if(monauralInputBuffer) delete monauralInputBuffer;
   if(useAudioInputFile) sf_close(audioInputFile);
   if(audioFileBuffer) delete audioFileBuffer;
@@ -62,8 +73,60 @@ static int AudioIO_portaudioCallback(
 }
 
 void AudioIO::openAudioStream() {
-  if(!videoExportEnabled)
+  if(!videoExportEnabled) {
+    if(processingThreadEnabled)
+      startProcessingThread();
     portaudioOpenAudioStream();
+  }
+}
+
+static void *AudioIO_processingThread(void *userData) {
+  AudioIO *audioIO = (AudioIO *)userData;
+  audioIO->runProcessingThread();
+  return NULL;
+}
+
+void AudioIO::startProcessingThread() {
+  if(processingThreadRunning)
+    return;
+  if(!audioBlockQueue) {
+    audioBlockQueue = new AudioBlockQueue(audioParameters.bufferSize, processingQueueLength);
+    processingBuffer = new float [audioParameters.bufferSize];
+  }
+  processingThreadRunning = true;
+  if(pthread_create(&processingThread, NULL, AudioIO_processingThread, (void *) this) != 0) {
+    printf("failed to create audio processing thread\n");
+    exit(0);
+  }
+}
+
+void AudioIO::stopProcessingThread() {
+  if(!processingThreadRunning)
+    return;
+  __atomic_store_n(&processingThreadRunning, false, __ATOMIC_RELEASE);
+  pthread_join(processingThread, NULL);
+}
+
+void AudioIO::runProcessingThread() {
+  // the callback can't signal without risking a block on a lock, so the
+  // queue is polled a few times per buffer period instead
+  float bufferPeriodMs = 1000.0f * audioParameters.bufferSize / audioParameters.sampleRate;
+  useconds_t pollInterval = (useconds_t) (250 * bufferPeriodMs);
+  Stopwatch sinceLastBlock; // started by the first block
+  while(__atomic_load_n(&processingThreadRunning, __ATOMIC_ACQUIRE)) {
+    // a block overdue by a whole buffer period is an underrun: popping the
+    // still empty queue counts it, and the next one is due a period later
+    if(audioBlockQueue->getNumQueuedBlocks() > 0
+       || (sinceLastBlock.isRunning()
+	   && sinceLastBlock.getElapsedMilliseconds() > 2 * bufferPeriodMs)) {
+      bool popped = audioBlockQueue->pop(processingBuffer);
+      sinceLastBlock.start();
+      if(popped)
+	processAudio(processingBuffer);
+    }
+    else
+      usleep(pollInterval);
+  }
 }
 
 void AudioIO::portaudioOpenAudioStream() {
@@ -163,7 +226,10 @@ int AudioIO::audioCallback(float *inputBuffer, float *outputBuffer, unsigned lon
     }
   }
 
-  processAudio(monauralInputBuffer);
+  if(__atomic_load_n(&processingThreadRunning, __ATOMIC_ACQUIRE))
+    audioBlockQueue->push(monauralInputBuffer);
+  else
+    processAudio(monauralInputBuffer);
 
   return 0;
 }
@@ -214,3 +280,16 @@ void AudioIO::rewindAudioInputFile() {
 void AudioIO::audioEnableVideoExport() {
   videoExportEnabled = true;
 }
+
+void AudioIO::audioEnableProcessingThread(unsigned long numQueuedBlocks) {
+  processingThreadEnabled = true;
+  processingQueueLength = numQueuedBlocks;
+}
+
+unsigned long AudioIO::getNumAudioOverruns() const {
+  return audioBlockQueue ? audioBlockQueue->getNumOverruns() : 0;
+}
+
+unsigned long AudioIO::getNumAudioUnderruns() const {
+  return audioBlockQueue ? audioBlockQueue->getNumUnderruns() : 0;
+}
@@ -14,14 +14,19 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <sonotopy/AudioParameters.hpp>
+#include <sonotopy/AudioBlockQueue.hpp>
 #include <portaudio.h>
 #include <sndfile.h>
+#include <pthread.h>
 
 class AudioIO {
 public:
   AudioIO();
   ~AudioIO();
   int audioCallback(float *inputBuffer, float *outputBuffer, unsigned long framesPerBuffer);
+  void runProcessingThread();
+  unsigned long getNumAudioOverruns() const; // input blocks dropped because processing fell behind
+  unsigned long getNumAudioUnderruns() const; // times a block was a whole buffer period late
 
 protected:
   void initializeAudio();
@@ -31,6 +36,9 @@ protected:
   virtual void processAudio(float *) {}
   void rewindAudioInputFile();
   void audioEnableVideoExport();
+  void audioEnableProcessingThread(unsigned long numQueuedBlocks = 8);
+  void startProcessingThread();
+  void stopProcessingThread();
   void portaudioOpenAudioStream();
 
   bool useAudioInputFile;
@@ -43,4 +51,10 @@ protected:
   float *audioFileBuffer;
   sonotopy::AudioParameters audioParameters;
   bool videoExportEnabled;
+  bool processingThreadEnabled;
+  bool processingThreadRunning;
+  unsigned long processingQueueLength;
+  sonotopy::AudioBlockQueue *audioBlockQueue;
+  float *processingBuffer;
+  pthread_t processingThread;
 };
@@ -18,9 +18,14 @@
 #include <time.h>
 #include <sonotopy/sonotopy.hpp>
 #include <sonotopy/TwoDimArray.hpp>
+#include <sonotopy/CompressedCodebook.hpp>
+#include <sonotopy/SOMSnapshot.hpp>
+#include <sonotopy/MirroredCircularBuffer.hpp>
+#include <sonotopy/CircularBuffer.hpp>
 #include "math.h" // M_PI
 #include <algorithm>
 #include <stdio.h>
+#include <pthread.h>
 
 using namespace sonotopy;
 
@@ -300,6 +305,1128 @@ TEST(StressTestSOM) {
     printf("%d: %d\n", i, winnerCount[i]);
 }
 
+TEST(SOMKernels) {
+  // vectorized kernels should agree with the scalar ones for any size
+  unsigned int sizes[] = { 1, 3, 16, 36, 37, 64 };
+  float precision = 0.0001f;
+  float model[64], input[64], scalarModel[64], simdModel[64];
+  SOMKernels::InstructionSet instructionSets[] = {
+    SOMKernels::SSE2, SOMKernels::AVX2, SOMKernels::AVX512 };
+  SOMKernels::SquaredDistanceFunction scalarDistance =
+    SOMKernels::getSquaredDistanceFunction(SOMKernels::Scalar);
+  SOMKernels::MoveTowardsFunction scalarMoveTowards =
+    SOMKernels::getMoveTowardsFunction(SOMKernels::Scalar);
+
+  srand(1);
+  for(unsigned int k = 0; k < 64; k++) {
+    model[k] = (float) rand() / RAND_MAX;
+    input[k] = (float) rand() / RAND_MAX;
+  }
+
+  for(unsigned int i = 0; i < 3; i++) {
+    if(!SOMKernels::isSupported(instructionSets[i]))
+      continue;
+    SOMKernels::SquaredDistanceFunction distance =
+      SOMKernels::getSquaredDistanceFunction(instructionSets[i]);
+    SOMKernels::MoveTowardsFunction moveTowards =
+      SOMKernels::getMoveTowardsFunction(instructionSets[i]);
+    for(unsigned int j = 0; j < 6; j++) {
+      unsigned int size = sizes[j];
+      CHECK_CLOSE(scalarDistance(model, input, size), distance(model, input, size), precision);
+      std::copy(model, model + 64, scalarModel);
+      std::copy(model, model + 64, simdModel);
+      scalarMoveTowards(scalarModel, input, size, 0.3f);
+      moveTowards(simdModel, input, size, 0.3f);
+      for(unsigned int k = 0; k < 64; k++)
+        CHECK_CLOSE(scalarModel[k], simdModel[k], precision);
+    }
+  }
+}
+
+TEST(FixedSizeSOMKernels) {
+  // fixed-size kernels agree with the generic ones of the same instruction set
+  unsigned int sizes[] = { 32, 48, 64 };
+  float precision = 0.0001f;
+  float model[64], input[64], genericModel[64], fixedModel[64];
+  SOMKernels::InstructionSet instructionSets[] = {
+    SOMKernels::Scalar, SOMKernels::SSE2, SOMKernels::AVX2, SOMKernels::AVX512 };
+
+  srand(2);
+  for(unsigned int k = 0; k < 64; k++) {
+    model[k] = (float) rand() / RAND_MAX;
+    input[k] = (float) rand() / RAND_MAX;
+  }
+  CHECK(!SOMKernels::hasFixedSizeKernels(36));
+  CHECK(SOMKernels::getSquaredDistanceFunction(SOMKernels::Scalar, 36)
+	== SOMKernels::getSquaredDistanceFunction(SOMKernels::Scalar));
+
+  for(unsigned int i = 0; i < 4; i++) {
+    if(!SOMKernels::isSupported(instructionSets[i]))
+      continue;
+    for(unsigned int j = 0; j < 3; j++) {
+      unsigned int size = sizes[j];
+      CHECK(SOMKernels::hasFixedSizeKernels(size));
+      CHECK_CLOSE(SOMKernels::getSquaredDistanceFunction(instructionSets[i])(model, input, size),
+		  SOMKernels::getSquaredDistanceFunction(instructionSets[i], size)(model, input, size),
+		  precision);
+      CHECK_CLOSE(SOMKernels::getDotProductFunction(instructionSets[i])(model, input, size),
+		  SOMKernels::getDotProductFunction(instructionSets[i], size)(model, input, size),
+		  precision);
+      std::copy(model, model + 64, genericModel);
+      std::copy(model, model + 64, fixedModel);
+      SOMKernels::getMoveTowardsFunction(instructionSets[i])(genericModel, input, size, 0.3f);
+      SOMKernels::getMoveTowardsFunction(instructionSets[i], size)(fixedModel, input, size, 0.3f);
+      for(unsigned int k = 0; k < 64; k++)
+        CHECK_CLOSE(genericModel[k], fixedModel[k], precision);
+    }
+  }
+}
+
+TEST(SOMInstructionSets) {
+  // training with the best available kernels gives the same winners as scalar training
+  unsigned int inputSize = 36;
+  RectGridTopology topology(8, 8);
+  SOM scalarNet(inputSize, &topology);
+  SOM net(inputSize, &topology);
+  scalarNet.setInstructionSet(SOMKernels::Scalar);
+  CHECK_EQUAL(SOMKernels::Scalar, scalarNet.getInstructionSet());
+  srand(1);
+  scalarNet.setRandomModelValues();
+  srand(1);
+  net.setRandomModelValues();
+  scalarNet.setNeighbourhoodParameter(0.1);
+  net.setNeighbourhoodParameter(0.1);
+
+  SOM::Sample input(inputSize);
+  for(int i = 0; i < 100; i++) {
+    for(unsigned int j = 0; j < inputSize; j++)
+      input[j] = (float) rand() / RAND_MAX;
+    scalarNet.train(input);
+    net.train(input);
+    CHECK_EQUAL(scalarNet.getLastWinner(), net.getLastWinner());
+  }
+  for(unsigned int k = 0; k < inputSize; k++)
+    CHECK_CLOSE(scalarNet.getModel(10)[k], net.getModel(10)[k], 0.0001f);
+}
+
+TEST(SOMThreads) {
+  // multi-threaded training gives exactly the same result as single-threaded
+  unsigned int inputSize = 36;
+  RectGridTopology topology(40, 40);
+  SOM net(inputSize, &topology);
+  SOM threadedNet(inputSize, &topology);
+  threadedNet.setNumThreads(4);
+  CHECK_EQUAL(4u, threadedNet.getNumThreads());
+  srand(1);
+  net.setRandomModelValues();
+  srand(1);
+  threadedNet.setRandomModelValues();
+  net.setNeighbourhoodParameter(0.02);
+  threadedNet.setNeighbourhoodParameter(0.02);
+
+  SOM::Sample input(inputSize);
+  SOM::Output output, threadedOutput;
+  for(int i = 0; i < 50; i++) {
+    for(unsigned int j = 0; j < inputSize; j++)
+      input[j] = (float) rand() / RAND_MAX;
+    net.train(input);
+    threadedNet.train(input);
+    CHECK_EQUAL(net.getLastWinner(), threadedNet.getLastWinner());
+    CHECK_EQUAL(net.getOutputMin(), threadedNet.getOutputMin());
+    CHECK_EQUAL(net.getOutputMax(), threadedNet.getOutputMax());
+  }
+  net.getLastOutput(output);
+  threadedNet.getLastOutput(threadedOutput);
+  CHECK(output == threadedOutput);
+  for(unsigned int id = 0; id < topology.getNumNodes(); id++)
+    CHECK(std::equal(net.getModel(id), net.getModel(id) + inputSize, threadedNet.getModel(id)));
+}
+
+TEST(TopologyNeighbourCache) {
+  float precision = 0.0001f;
+  RectGridTopology topology(7, 5);
+  topology.setVicinityFactor(0.3f);
+  std::vector<Topology::Neighbour> neighbours;
+  topology.getNeighbours(12, neighbours);
+
+  // same neighbours as a full scan
+  unsigned int numExpected = 0;
+  for(unsigned int id = 0; id < topology.getNumNodes(); id++)
+    if(id != 12 && topology.getDistance(12, id) < topology.getVicinityFactor())
+      numExpected++;
+  CHECK_EQUAL(numExpected, neighbours.size());
+  for(unsigned int i = 0; i < neighbours.size(); i++) {
+    float distance = topology.getDistance(12, neighbours[i].nodeId);
+    CHECK_CLOSE((topology.getVicinityFactor() - distance) / topology.getVicinityFactor(),
+		neighbours[i].strength, precision);
+  }
+
+  // a marginal change of the vicinity factor reuses the cached list
+  const std::vector<Topology::Neighbour> *cached = &topology.getNeighbours(12);
+  unsigned int level = topology.getVicinityLevel();
+  topology.setVicinityFactor(0.3f + 0.1f / Topology::numVicinityLevels);
+  CHECK_EQUAL(level, topology.getVicinityLevel());
+  CHECK(cached == &topology.getNeighbours(12));
+  CHECK_EQUAL(numExpected, cached->size());
+
+  topology.setVicinityFactor(0);
+  CHECK_EQUAL((size_t) 0, topology.getNeighbours(12).size());
+}
+
+TEST(StencilSOM) {
+  // a rect grid trained through its stencil matches the same grid trained
+  // through neighbour lists (a disjoint grid containing every node)
+  unsigned int inputSize = 5;
+  unsigned int gridWidth = 9;
+  unsigned int gridHeight = 6;
+  std::vector<DisjointGridTopology::Node> nodes;
+  for(unsigned int y = 0; y < gridHeight; y++)
+    for(unsigned int x = 0; x < gridWidth; x++)
+      nodes.push_back(DisjointGridTopology::Node(x, y));
+  RectGridTopology rectTopology(gridWidth, gridHeight);
+  DisjointGridTopology listTopology(gridWidth, gridHeight, nodes);
+  SOM stencilNet(inputSize, &rectTopology);
+  SOM listNet(inputSize, &listTopology);
+  srand(1);
+  stencilNet.setRandomModelValues();
+  srand(1);
+  listNet.setRandomModelValues();
+
+  SOM::Sample input(inputSize);
+  for(int i = 0; i < 40; i++) {
+    stencilNet.setNeighbourhoodParameter(1.0f - i * 0.02f);
+    listNet.setNeighbourhoodParameter(1.0f - i * 0.02f);
+    for(unsigned int j = 0; j < inputSize; j++)
+      input[j] = (float) rand() / RAND_MAX;
+    stencilNet.train(input);
+    listNet.train(input);
+    CHECK_EQUAL(listNet.getLastWinner(), stencilNet.getLastWinner());
+  }
+  for(unsigned int id = 0; id < rectTopology.getNumNodes(); id++)
+    for(unsigned int k = 0; k < inputSize; k++)
+      CHECK_CLOSE(listNet.getModel(id)[k], stencilNet.getModel(id)[k], 0.00001f);
+
+  // the circle stencil wraps around and visits each neighbour once
+  CircleTopology circle(10);
+  circle.setVicinityFactor(0.5f);
+  const std::vector<Topology::Neighbour> &neighbours = circle.getNeighbours(1);
+  CHECK_EQUAL((size_t) 4, neighbours.size());
+  for(unsigned int i = 0; i < neighbours.size(); i++) {
+    CHECK(neighbours[i].nodeId == 9 || neighbours[i].nodeId == 0 ||
+	  neighbours[i].nodeId == 2 || neighbours[i].nodeId == 3);
+    CHECK_CLOSE((0.5f - circle.getDistance(1, neighbours[i].nodeId)) / 0.5f,
+		neighbours[i].strength, 0.0001f);
+  }
+}
+
+TEST(BatchSOM) {
+  // batch training searches every winner against the models as they were
+  // before the batch, and its output is that of the last input
+  unsigned int inputSize = 36;
+  unsigned int batchSize = 5;
+  float precision = 0.0001f;
+  RectGridTopology topology(20, 20);
+  SOM net(inputSize, &topology);
+  srand(1);
+  net.setRandomModelValues();
+  net.setNeighbourhoodParameter(0.05);
+
+  std::vector<SOM::Sample> batch(batchSize, SOM::Sample(inputSize));
+  SOM::Output expectedOutput, output;
+  for(int i = 0; i < 20; i++) {
+    for(unsigned int b = 0; b < batchSize; b++)
+      for(unsigned int j = 0; j < inputSize; j++)
+	batch[b][j] = (float) rand() / RAND_MAX;
+    unsigned int expectedWinner = net.getWinner(batch[batchSize - 1]);
+    net.getOutput(batch[batchSize - 1], expectedOutput);
+    float expectedOutputMin = *std::min_element(expectedOutput.begin(), expectedOutput.end());
+    float expectedOutputMax = *std::max_element(expectedOutput.begin(), expectedOutput.end());
+
+    net.trainBatch(batch);
+    CHECK_EQUAL(expectedWinner, net.getLastWinner());
+    CHECK_CLOSE(expectedOutputMin, net.getOutputMin(), precision);
+    CHECK_CLOSE(expectedOutputMax, net.getOutputMax(), precision);
+    net.getLastOutput(output);
+    for(unsigned int id = 0; id < topology.getNumNodes(); id++)
+      CHECK_CLOSE(expectedOutput[id], output[id], precision);
+  }
+
+  // a batch of one is ordinary training
+  SOM reference(inputSize, &topology);
+  SOM single(inputSize, &topology);
+  reference.setAllModels(batch[0]);
+  single.setAllModels(batch[0]);
+  std::vector<SOM::Sample> singleBatch(1, batch[1]);
+  reference.train(batch[1]);
+  single.trainBatch(singleBatch);
+  CHECK_EQUAL(reference.getLastWinner(), single.getLastWinner());
+  CHECK_CLOSE(reference.getModel(7)[3], single.getModel(7)[3], precision);
+
+  // inputs sharing a winner move it once, towards their mean, and the
+  // exhaustive batch search counts as full searches
+  SOM shared(inputSize, &topology);
+  SOM::Sample model(inputSize, 0.5f);
+  shared.setAllModels(model);
+  shared.setNeighbourhoodParameter(0);
+  shared.setLearningParameter(0.4f);
+  std::vector<SOM::Sample> pair(2, model);
+  pair[0][0] = 0.7f;
+  pair[1][0] = 0.9f;
+  shared.trainBatch(pair);
+  unsigned int winner = shared.getLastWinner();
+  CHECK_CLOSE(0.5f + 0.4f * (0.8f - 0.5f), shared.getModel(winner)[0], precision);
+  CHECK_CLOSE(0.5f, shared.getModel(winner)[1], precision);
+  CHECK_CLOSE(0.5f, shared.getModel(winner == 0 ? 1 : 0)[0], precision);
+  CHECK_EQUAL(2ul, shared.getNumFullSearches());
+}
+
+TEST(LocalSearchSOM) {
+  // a smoothly ordered map with slowly moving input: the local search
+  // should find the same winners as a full scan, mostly without scanning
+  unsigned int inputSize = 2;
+  unsigned int gridSize = 16;
+  RectGridTopology topology(gridSize, gridSize);
+  SOM net(inputSize, &topology);
+  SOM::Sample model(inputSize);
+  for(unsigned int y = 0; y < gridSize; y++) {
+    for(unsigned int x = 0; x < gridSize; x++) {
+      model[0] = (float) x / gridSize;
+      model[1] = (float) y / gridSize;
+      net.setModel(topology.gridCoordinatesToId(x, y), model);
+    }
+  }
+  net.setLearningParameter(0);
+  net.setNeighbourhoodParameter(0);
+  net.setLocalSearch(true, 10, 0.1f);
+  CHECK(net.isLocalSearchEnabled());
+
+  SOM::Sample input(inputSize);
+  for(int i = 0; i < 100; i++) {
+    input[0] = 0.5f + 0.4f * (float) cos(i * 0.05);
+    input[1] = 0.5f + 0.4f * (float) sin(i * 0.05);
+    net.train(input);
+    CHECK_EQUAL(net.getWinner(input), net.getLastWinner());
+  }
+  CHECK_EQUAL(100ul, net.getNumLocalSearches() + net.getNumFullSearches());
+
+  // the last training was local, yet its outputs are complete
+  SOM::Output expectedOutput, output;
+  net.getOutput(input, expectedOutput);
+  net.getLastOutput(output);
+  for(unsigned int id = 0; id < topology.getNumNodes(); id++)
+    CHECK_CLOSE(expectedOutput[id], output[id], 0.0001f);
+  CHECK_CLOSE(*std::max_element(expectedOutput.begin(), expectedOutput.end()), net.getOutputMax(), 0.0001f);
+  CHECK_CLOSE(*std::min_element(expectedOutput.begin(), expectedOutput.end()), net.getOutputMin(), 0.0001f);
+  CHECK_EQUAL(10ul, net.getNumFullSearches());
+  CHECK_CLOSE(0.9f, net.getLocalSearchRate(), 0.0001f);
+
+  // an input poorly matched by the local winner triggers a full scan
+  input[0] = 2;
+  input[1] = 2;
+  unsigned long numFullSearches = net.getNumFullSearches();
+  net.setLocalSearch(true, 10, 0.01f);
+  net.train(input);
+  net.train(input);
+  CHECK_EQUAL(numFullSearches + 2, net.getNumFullSearches());
+  CHECK_EQUAL(net.getWinner(input), net.getLastWinner());
+}
+
+TEST(HierarchicalSearchSOM) {
+  // on a smoothly ordered map the coarse-to-fine search should find the
+  // exhaustive winner, also after training has moved part of the models
+  unsigned int inputSize = 2;
+  unsigned int gridSize = 40;
+  RectGridTopology topology(gridSize, gridSize);
+  SOM net(inputSize, &topology);
+  net.setHierarchicalSearch(true, 4, 3);
+  CHECK(net.isHierarchicalSearchEnabled());
+  SOM::Sample model(inputSize);
+  for(unsigned int y = 0; y < gridSize; y++) {
+    for(unsigned int x = 0; x < gridSize; x++) {
+      model[0] = (float) x / gridSize;
+      model[1] = (float) y / gridSize;
+      net.setModel(topology.gridCoordinatesToId(x, y), model);
+    }
+  }
+  net.setLearningParameter(0.05f);
+  net.setNeighbourhoodParameter(0.05f);
+
+  SOM::Sample input(inputSize);
+  srand(17);
+  for(int i = 0; i < 200; i++) {
+    input[0] = (float) rand() / RAND_MAX;
+    input[1] = (float) rand() / RAND_MAX;
+    unsigned int winner = net.getWinner(input);
+    net.train(input);
+    CHECK_EQUAL(winner, net.getLastWinner());
+  }
+  CHECK_EQUAL(150ul, net.getNumHierarchicalSearches());
+  CHECK_EQUAL(50ul, net.getNumVerifiedSearches());
+  CHECK_CLOSE(1.0f, net.getHierarchicalSearchAccuracy(), 0.0001f);
+
+  // a hierarchical search leaves complete outputs
+  net.train(input);
+  CHECK_EQUAL(151ul, net.getNumHierarchicalSearches());
+  SOM::Output expectedOutput, output;
+  net.getOutput(input, expectedOutput);
+  net.getLastOutput(output);
+  for(unsigned int id = 0; id < topology.getNumNodes(); id++)
+    CHECK_CLOSE(expectedOutput[id], output[id], 0.0001f);
+  CHECK_CLOSE(*std::max_element(expectedOutput.begin(), expectedOutput.end()), net.getOutputMax(), 0.0001f);
+
+  CircleTopology circleTopology(10);
+  SOM circleNet(inputSize, &circleTopology);
+  bool thrown = false;
+  try {
+    circleNet.setHierarchicalSearch(true);
+  }
+  catch(std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+}
+
+TEST(HierarchicalSearchAfterFullInvalidation) {
+  // cells marked by a training just before all models are replaced must
+  // still be refreshed when the models under them change later
+  unsigned int inputSize = 2;
+  unsigned int gridSize = 16;
+  RectGridTopology topology(gridSize, gridSize);
+  SOM net(inputSize, &topology);
+  net.setHierarchicalSearch(true, 1, 1000);
+  SOM::Sample input(inputSize);
+  input[0] = input[1] = 0.3f;
+  net.setAllModels(input);
+  net.setNeighbourhoodParameter(0.05f);
+  net.setLearningParameter(0);
+  net.train(input);
+  SOM::Sample zero(inputSize, 0);
+  net.setAllModels(zero);
+  net.train(input);
+
+  // on a ramp, the beam search finds any input that equals a model
+  SOM::Sample model(inputSize);
+  for(unsigned int y = 0; y < gridSize; y++) {
+    for(unsigned int x = 0; x < gridSize; x++) {
+      model[0] = (float) x / gridSize;
+      model[1] = (float) y / gridSize;
+      net.setModel(topology.gridCoordinatesToId(x, y), model);
+    }
+  }
+  for(unsigned int id = 0; id < topology.getNumNodes(); id++) {
+    input = net.createSample(net.getModel(id));
+    net.train(input);
+    CHECK_EQUAL(net.getWinner(input), net.getLastWinner());
+  }
+}
+
+TEST(LazySOMOutput) {
+  // outputs and activation are derived from the stored distances on request
+  unsigned int inputSize = 3;
+  RectGridTopology topology(7, 5);
+  SOM net(inputSize, &topology);
+  srand(5);
+  net.setRandomModelValues(0, 1);
+  SOM::Sample input(inputSize);
+  input[0] = 0.2f;
+  input[1] = 0.7f;
+  input[2] = 0.4f;
+  net.train(input);
+
+  SOM::Output output;
+  net.getLastOutput(output);
+  CHECK_EQUAL(topology.getNumNodes(), output.size());
+  SOM::ActivationPattern *activationPattern = net.createActivationPattern();
+  net.getActivationPattern(activationPattern);
+  float range = net.getOutputMax() - net.getOutputMin();
+  for(unsigned int i = 0; i < output.size(); i++) {
+    CHECK_CLOSE(1.0f - (output[i] - net.getOutputMin()) / range, (*activationPattern)[i], 0.0001f);
+  }
+  CHECK_CLOSE(net.getOutputMin(), output[net.getLastWinner()], 0.0001f);
+  CHECK_CLOSE(1.0f, (*activationPattern)[net.getLastWinner()], 0.0001f);
+
+  SOM::Output expected(topology.getNumNodes());
+  for(unsigned int i = 0; i < topology.getNumNodes(); i++) {
+    float distance = 0;
+    for(unsigned int k = 0; k < inputSize; k++)
+      distance += (net.getModel(i)[k] - input[k]) * (net.getModel(i)[k] - input[k]);
+    expected[i] = sqrt(distance) / sqrt((float) inputSize);
+  }
+  net.getOutput(input, output);
+  for(unsigned int i = 0; i < topology.getNumNodes(); i++)
+    CHECK_CLOSE(expected[i], output[i], 0.0001f);
+  delete activationPattern;
+}
+
+TEST(CompressedCodebookAccuracy) {
+  unsigned int inputSize = 20;
+  RectGridTopology topology(16, 16);
+  SOM net(inputSize, &topology);
+  srand(3);
+  net.setRandomModelValues(0, 1);
+
+  std::vector<SOM::Sample> inputs;
+  for(int i = 0; i < 50; i++) {
+    SOM::Sample input(inputSize);
+    for(unsigned int k = 0; k < inputSize; k++)
+      input[k] = (float) rand() / RAND_MAX;
+    inputs.push_back(input);
+  }
+
+  CHECK_CLOSE(0.5f, SOMKernels::halfToFloat(SOMKernels::floatToHalf(0.5f)), 0);
+  CHECK_CLOSE(0.1f, SOMKernels::halfToFloat(SOMKernels::floatToHalf(0.1f)), 0.0001f);
+  CHECK_CLOSE(-3e-6f, SOMKernels::halfToFloat(SOMKernels::floatToHalf(-3e-6f)), 1e-7f);
+
+  CompressedCodebook halfCodebook(&net, CompressedCodebook::Half);
+  CompressedCodebook byteCodebook(&net, CompressedCodebook::Byte);
+  CHECK(halfCodebook.getNumBytes() < topology.getNumNodes() * inputSize * sizeof(float));
+  CHECK(byteCodebook.getNumBytes() < halfCodebook.getNumBytes());
+
+  CompressedCodebook::AccuracyReport report = halfCodebook.getAccuracy(inputs);
+  CHECK_EQUAL(50u, report.numInputs);
+  CHECK(report.maxModelError < 0.001f);
+  CHECK(report.winnerAgreement > 0.9f);
+  CHECK(report.meanOutputIncrease < 0.001f);
+
+  report = byteCodebook.getAccuracy(inputs);
+  CHECK(report.maxModelError < 0.5f / 255 + 0.0001f);
+  CHECK(report.winnerAgreement > 0.8f);
+  CHECK(report.meanOutputIncrease < 0.01f);
+
+  // all instruction sets find the same winners
+  for(int instructionSet = SOMKernels::Scalar; instructionSet <= SOMKernels::AVX512; instructionSet++) {
+    if(!SOMKernels::isSupported((SOMKernels::InstructionSet) instructionSet))
+      continue;
+    CompressedCodebook codebook(&net, CompressedCodebook::Byte);
+    codebook.setInstructionSet((SOMKernels::InstructionSet) instructionSet);
+    for(int i = 0; i < 50; i++)
+      CHECK_EQUAL(byteCodebook.getWinner(inputs[i]), codebook.getWinner(inputs[i]));
+  }
+}
+
+TEST(SOMSnapshotRoundTrip) {
+  const char *filename = "unittest_snapshot.som";
+  unsigned int inputSize = 5;
+  RectGridTopology topology(6, 4);
+  SOM net(inputSize, &topology);
+  srand(11);
+  net.setRandomModelValues(0, 1);
+  net.setNeighbourhoodParameter(0.25f);
+  net.setLearningParameter(0.125f);
+  const char state[] = "adaptation state";
+  SOMSnapshot::write(net, filename, state, sizeof(state));
+
+  {
+    SOMSnapshot snapshot(filename);
+    CHECK_EQUAL(inputSize, snapshot.getHeader().inputSize);
+    CHECK_EQUAL(24u, snapshot.getHeader().numModels);
+    CHECK_EQUAL((uint32_t) SOMSnapshot::RectGrid, snapshot.getHeader().topologyType);
+    CHECK_EQUAL(0, ((size_t) snapshot.getModel(0)) % 64);
+    for(unsigned int i = 0; i < 24; i++)
+      for(unsigned int k = 0; k < inputSize; k++)
+	CHECK_EQUAL(net.getModel(i)[k], snapshot.getModel(i)[k]);
+    CHECK_EQUAL(sizeof(state), snapshot.getStateSize());
+    CHECK(strcmp(state, (const char *) snapshot.getState()) == 0);
+
+    RectGridTopology restoredTopology(6, 4);
+    SOM restored(inputSize, &restoredTopology);
+    snapshot.restore(restored);
+    CHECK_EQUAL(0.25f, restored.getNeighbourhoodParameter());
+    CHECK_EQUAL(0.125f, restored.getLearningParameter());
+    for(unsigned int i = 0; i < 24; i++)
+      for(unsigned int k = 0; k < inputSize; k++)
+	CHECK_EQUAL(net.getModel(i)[k], restored.getModel(i)[k]);
+
+    RectGridTopology otherTopology(4, 6);
+    SOM other(inputSize, &otherTopology);
+    bool thrown = false;
+    try {
+      snapshot.restore(other);
+    }
+    catch(std::runtime_error &) {
+      thrown = true;
+    }
+    CHECK(thrown);
+  }
+
+  // a flipped byte in the model data is detected
+  FILE *f = fopen(filename, "r+b");
+  fseek(f, 200, SEEK_SET);
+  int c = fgetc(f);
+  fseek(f, 200, SEEK_SET);
+  fputc(c ^ 1, f);
+  fclose(f);
+  bool thrown = false;
+  try {
+    SOMSnapshot snapshot(filename);
+  }
+  catch(std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  remove(filename);
+}
+
+TEST(SpectrumMapWarmStart) {
+  const char *filename = "unittest_warmstart.som";
+  AudioParameters audioParameters;
+  GridMapParameters gridMapParameters;
+  gridMapParameters.gridWidth = 8;
+  gridMapParameters.gridHeight = 6;
+  GridMap trained(audioParameters, SpectrumAnalyzerParameters(), gridMapParameters);
+  float *audio = new float [audioParameters.bufferSize];
+  for(int buffer = 0; buffer < 20; buffer++) {
+    for(unsigned int i = 0; i < audioParameters.bufferSize; i++)
+      audio[i] = (float) sin((buffer * audioParameters.bufferSize + i) * 0.05);
+    trained.feedAudio(audio, audioParameters.bufferSize);
+  }
+  trained.writeSnapshot(filename);
+
+  GridMap restored(audioParameters, SpectrumAnalyzerParameters(), gridMapParameters);
+  restored.restoreSnapshot(filename);
+  remove(filename);
+  for(unsigned int y = 0; y < 6; y++)
+    for(unsigned int x = 0; x < 8; x++)
+      for(int k = 0; k < trained.getSpectrumResolution(); k++)
+	CHECK_EQUAL(trained.getModel(x, y)[k], restored.getModel(x, y)[k]);
+  const float *trainedBins = trained.getSpectrumBinDivider()->getBinValues();
+  const float *restoredBins = restored.getSpectrumBinDivider()->getBinValues();
+  for(int k = 0; k < trained.getSpectrumResolution(); k++)
+    CHECK_EQUAL(trainedBins[k], restoredBins[k]);
+
+  // both continue in the same adaptation phase
+  trained.feedAudio(audio, audioParameters.bufferSize);
+  restored.feedAudio(audio, audioParameters.bufferSize);
+  CHECK_CLOSE(trained.getNeighbourhoodParameter(), restored.getNeighbourhoodParameter(), 0.0001f);
+  CHECK_CLOSE(trained.getAdaptationTimeSecs(), restored.getAdaptationTimeSecs(), 0.0001f);
+
+  // restoring a map doesn't reset the spectrum integration shared with other maps
+  trained.writeSnapshot(filename);
+  SpectrumFrontEnd frontEnd(audioParameters, SpectrumAnalyzerParameters());
+  GridMap sharing(&frontEnd, gridMapParameters);
+  GridMap restoredSharing(&frontEnd, gridMapParameters);
+  for(int buffer = 0; buffer < 5; buffer++)
+    frontEnd.feedAudio(audio, audioParameters.bufferSize);
+  std::vector<float> sharedBins(frontEnd.getBinValues(),
+				frontEnd.getBinValues() + frontEnd.getSpectrumBinDivider()->getNumBins());
+  restoredSharing.restoreSnapshot(filename);
+  remove(filename);
+  for(unsigned int k = 0; k < sharedBins.size(); k++)
+    CHECK_EQUAL(sharedBins[k], frontEnd.getBinValues()[k]);
+  CHECK_EQUAL(trained.getModel(0, 0)[0], restoredSharing.getModel(0, 0)[0]);
+  delete [] audio;
+}
+
+TEST(SpectrumFrontEndSharedAnalysis) {
+  AudioParameters audioParameters;
+  GridMapParameters gridMapParameters;
+  gridMapParameters.gridWidth = 5;
+  gridMapParameters.gridHeight = 4;
+  srand(1);
+  GridMap standaloneMap(audioParameters, SpectrumAnalyzerParameters(), gridMapParameters);
+  SpectrumFrontEnd frontEnd(audioParameters, SpectrumAnalyzerParameters());
+  srand(1);
+  GridMap sharedMap(&frontEnd, gridMapParameters);
+  CircleMap circleMap(&frontEnd, CircleMapParameters());
+  BeatTracker beatTracker(&frontEnd);
+  BeatTracker standaloneBeatTracker(standaloneMap.getSpectrumResolution(),
+				    audioParameters.bufferSize, audioParameters.sampleRate);
+  CHECK_EQUAL(standaloneMap.getSpectrumResolution(), sharedMap.getSpectrumResolution());
+
+  float *audio = new float [audioParameters.bufferSize];
+  for(int buffer = 0; buffer < 10; buffer++) {
+    for(unsigned int i = 0; i < audioParameters.bufferSize; i++)
+      audio[i] = (float) sin((buffer * audioParameters.bufferSize + i) * 0.03);
+    standaloneMap.feedAudio(audio, audioParameters.bufferSize);
+    standaloneBeatTracker.feedFeatureVector(standaloneMap.getSpectrumBinDivider()->getBinValues());
+    frontEnd.feedAudio(audio, audioParameters.bufferSize);
+  }
+  for(unsigned int y = 0; y < 4; y++)
+    for(unsigned int x = 0; x < 5; x++)
+      for(int k = 0; k < sharedMap.getSpectrumResolution(); k++)
+	CHECK_EQUAL(standaloneMap.getModel(x, y)[k], sharedMap.getModel(x, y)[k]);
+  CHECK_EQUAL(standaloneMap.getWinnerId(), sharedMap.getWinnerId());
+  CHECK_EQUAL(standaloneBeatTracker.getIntensity(), beatTracker.getIntensity());
+  CHECK(circleMap.getSpectrumBinDivider() == sharedMap.getSpectrumBinDivider());
+  bool thrown = false;
+  try {
+    sharedMap.feedAudio(audio, audioParameters.bufferSize);
+  }
+  catch(std::runtime_error &) {
+    thrown = true;
+  }
+  CHECK(thrown);
+  delete [] audio;
+}
+
+static void *readPublishedModels(void *arg) {
+  ModelPublisher *publisher = (ModelPublisher *) arg;
+  unsigned long previousVersion = 0;
+  bool consistent = true;
+  for(int i = 0; i < 20000; i++) {
+    const ModelPublisher::Snapshot *snapshot = publisher->acquire();
+    if(!snapshot)
+      continue;
+    // the writer fills every value of a version with the version number
+    unsigned long version = snapshot->getVersion();
+    for(unsigned int id = 0; id < 16; id++)
+      for(unsigned int k = 0; k < 16; k++)
+	if(snapshot->getModel(id)[k] != (float) version)
+	  consistent = false;
+    if(version < previousVersion)
+      consistent = false;
+    previousVersion = version;
+    publisher->release(snapshot);
+  }
+  return consistent ? arg : NULL;
+}
+
+TEST(ModelPublisherConsistency) {
+  ModelPublisher publisher(16, 16, 4);
+  CHECK(publisher.acquire() == NULL);
+  pthread_t readers[2];
+  for(int r = 0; r < 2; r++)
+    pthread_create(&readers[r], NULL, readPublishedModels, &publisher);
+  std::vector<float> models(16 * 16);
+  for(unsigned long version = 1; version <= 20000; version++) {
+    std::fill(models.begin(), models.end(), (float) version);
+    publisher.publish(&models[0], version);
+  }
+  for(int r = 0; r < 2; r++) {
+    void *result;
+    pthread_join(readers[r], &result);
+    CHECK(result != NULL);
+  }
+  CHECK_EQUAL(20000ul, publisher.getNumPublications() + publisher.getNumSkippedPublications());
+  const ModelPublisher::Snapshot *snapshot = publisher.acquire();
+  CHECK(snapshot != NULL);
+  publisher.release(snapshot);
+
+  // a SOM publishes its models after every training
+  RectGridTopology topology(4, 4);
+  SOM net(3, &topology);
+  net.setModelPublication(true);
+  SOM::Sample input(3, 0.5f);
+  net.train(input);
+  snapshot = net.getModelPublisher()->acquire();
+  CHECK_EQUAL(1ul, snapshot->getVersion());
+  for(unsigned int id = 0; id < 16; id++)
+    for(unsigned int k = 0; k < 3; k++)
+      CHECK_EQUAL(net.getModel(id)[k], snapshot->getModel(id)[k]);
+  net.getModelPublisher()->release(snapshot);
+}
+
+TEST(SpectrumMapFramePublication) {
+  AudioParameters audioParameters;
+  GridMapParameters gridMapParameters;
+  gridMapParameters.gridWidth = 5;
+  gridMapParameters.gridHeight = 4;
+  GridMap gridMap(audioParameters, SpectrumAnalyzerParameters(), gridMapParameters);
+  CHECK(gridMap.acquireFrame() == NULL);
+  gridMap.setFramePublication(true);
+  CHECK(gridMap.acquireFrame() == NULL);
+
+  float *audio = new float [audioParameters.bufferSize];
+  for(unsigned int i = 0; i < audioParameters.bufferSize; i++)
+    audio[i] = (float) sin(i * 0.1);
+  gridMap.feedAudio(audio, audioParameters.bufferSize);
+  const SpectrumMap::Frame *frame = gridMap.acquireFrame();
+  CHECK(frame != NULL);
+  CHECK_EQUAL(gridMap.getWinnerId(), frame->winnerId);
+  CHECK_EQUAL(20u, frame->activationPattern.size());
+  CHECK_CLOSE(1.0f, frame->activationPattern[frame->winnerId], 0.0001f);
+  const SOM::ActivationPattern *activationPattern = gridMap.getActivationPattern();
+  for(unsigned int i = 0; i < 20; i++)
+    CHECK_EQUAL((*activationPattern)[i], frame->activationPattern[i]);
+  RectGridTopology::Node node = ((RectGridTopology *) gridMap.getTopology())->getNode(frame->winnerId);
+  CHECK_CLOSE((node.x + 0.5f) / 5, frame->cursorX, 0.0001f);
+  CHECK_CLOSE((node.y + 0.5f) / 4, frame->cursorY, 0.0001f);
+
+  // a held frame stays unchanged while newer ones are published
+  float elapsedTimeSecs = frame->elapsedTimeSecs;
+  gridMap.feedAudio(audio, audioParameters.bufferSize);
+  gridMap.feedAudio(audio, audioParameters.bufferSize);
+  CHECK_EQUAL(elapsedTimeSecs, frame->elapsedTimeSecs);
+  const SpectrumMap::Frame *latest = gridMap.acquireFrame();
+  CHECK(latest->elapsedTimeSecs > elapsedTimeSecs);
+  gridMap.releaseFrame(latest);
+  gridMap.releaseFrame(frame);
+  delete [] audio;
+}
+
+TEST(DirtyModelTracking) {
+  // the dirty set holds exactly the models that training changed
+  unsigned int inputSize = 4;
+  RectGridTopology topology(12, 10);
+  CircleTopology circleTopology(15);
+  Topology *topologies[] = { &topology, &circleTopology };
+  for(int t = 0; t < 2; t++) {
+    SOM net(inputSize, topologies[t]);
+    unsigned int numModels = topologies[t]->getNumNodes();
+    srand(8);
+    net.setRandomModelValues(0, 1);
+    net.setDirtyTracking(true);
+    CHECK(net.isDirtyTrackingEnabled());
+    CHECK_EQUAL(0u, net.getDirtyModels().size());
+    net.setNeighbourhoodParameter(0.15f);
+    net.setLearningParameter(0.3f);
+
+    std::vector<float> before(numModels * inputSize);
+    for(unsigned int i = 0; i < numModels; i++)
+      for(unsigned int k = 0; k < inputSize; k++)
+	before[i * inputSize + k] = net.getModel(i)[k];
+    SOM::Sample input(inputSize, 0.5f);
+    net.train(input);
+
+    unsigned int numChanged = 0;
+    for(unsigned int i = 0; i < numModels; i++) {
+      bool changed = false;
+      for(unsigned int k = 0; k < inputSize; k++)
+	if(net.getModel(i)[k] != before[i * inputSize + k])
+	  changed = true;
+      if(changed) {
+	numChanged++;
+	CHECK(net.isModelDirty(i));
+      }
+    }
+    CHECK(numChanged > 0);
+    CHECK(numChanged < numModels);
+    CHECK(net.getDirtyModels().size() >= numChanged);
+    for(unsigned int i = 0; i < net.getDirtyModels().size(); i++)
+      CHECK(net.isModelDirty(net.getDirtyModels()[i]));
+
+    net.clearDirtyModels();
+    CHECK_EQUAL(0u, net.getDirtyModels().size());
+    CHECK(!net.isModelDirty(net.getLastWinner()));
+    net.setAllModels(input);
+    CHECK_EQUAL(numModels, net.getDirtyModels().size());
+  }
+}
+
+TEST(SeededModelInitialization) {
+  // the same seed gives the same models regardless of thread count and rand()
+  unsigned int inputSize = 20;
+  RectGridTopology topology(30, 20);
+  SOM net(inputSize, &topology);
+  SOM threadedNet(inputSize, &topology);
+  threadedNet.setNumThreads(3);
+  net.setRandomSeed(1234);
+  threadedNet.setRandomSeed(1234);
+  srand(1);
+  net.setRandomModelValues(0.25f, 0.5f);
+  srand(2);
+  threadedNet.setRandomModelValues(0.25f, 0.5f);
+  float sum = 0;
+  for(unsigned int i = 0; i < topology.getNumNodes(); i++)
+    for(unsigned int k = 0; k < inputSize; k++) {
+      CHECK_EQUAL(net.getModel(i)[k], threadedNet.getModel(i)[k]);
+      CHECK(net.getModel(i)[k] >= 0.25f && net.getModel(i)[k] < 0.5f);
+      sum += net.getModel(i)[k];
+    }
+  CHECK_CLOSE(0.375f, sum / (topology.getNumNodes() * inputSize), 0.01f);
+
+  // a second initialization continues the stream; reseeding restarts it
+  float first = net.getModel(7)[3];
+  net.setRandomModelValues(0.25f, 0.5f);
+  CHECK(net.getModel(7)[3] != first);
+  net.setRandomSeed(1234);
+  net.setRandomModelValues(0.25f, 0.5f);
+  CHECK_EQUAL(first, net.getModel(7)[3]);
+  net.setRandomSeed(4321);
+  net.setRandomModelValues(0.25f, 0.5f);
+  CHECK(net.getModel(7)[3] != first);
+}
+
+class SquaredLineTopology : public Topology {
+public:
+  unsigned int getNumNodes() { return 10; }
+  float getDistance(unsigned int a, unsigned int b) { int d = (int) a - (int) b; return (float) (d * d) / 100; }
+};
+
+TEST(TopologyDistanceTables) {
+  // table lookups agree with the distances computed from node coordinates
+  float precision = 0.00001f;
+  RectGridTopology grid(7, 5);
+  unsigned int x1, y1, x2, y2;
+  for(unsigned int a = 0; a < grid.getNumNodes(); a++)
+    for(unsigned int b = 0; b < grid.getNumNodes(); b++) {
+      grid.idToGridCoordinates(a, x1, y1);
+      grid.idToGridCoordinates(b, x2, y2);
+      float dx = (float) x1 - x2, dy = (float) y1 - y2;
+      CHECK_CLOSE((dx*dx + dy*dy) / (7*7 + 5*5), grid.lookupDistance(a, b), precision);
+    }
+
+  CircleTopology circle(9);
+  for(unsigned int a = 0; a < 9; a++)
+    for(unsigned int b = 0; b < 9; b++) {
+      float angularDistance = fabs(circle.getNode(a).angle - circle.getNode(b).angle);
+      if(angularDistance > M_PI)
+	angularDistance = 2 * M_PI - angularDistance;
+      CHECK_CLOSE(angularDistance / M_PI, circle.lookupDistance(a, b), precision);
+      CHECK_EQUAL(circle.lookupDistance(a, b), circle.lookupDistance(b, a));
+    }
+
+  std::vector<DisjointGridTopology::Node> nodes;
+  nodes.push_back(DisjointGridTopology::Node(0, 0));
+  nodes.push_back(DisjointGridTopology::Node(5, 1));
+  nodes.push_back(DisjointGridTopology::Node(2, 3));
+  DisjointGridTopology disjoint(6, 4, nodes);
+  CHECK_CLOSE((5*5 + 1*1) / (float) (6*6 + 4*4), disjoint.lookupDistance(0, 1), precision);
+  CHECK_CLOSE((3*3 + 2*2) / (float) (6*6 + 4*4), disjoint.lookupDistance(1, 2), precision);
+
+  SquaredLineTopology line;
+  CHECK_CLOSE(0.09f, line.lookupDistance(2, 5), precision);
+  CHECK_EQUAL(line.getDistance(9, 0), line.lookupDistance(9, 0));
+}
+
+TEST(SpectrumAnalyzerRealInputFFT) {
+  // the single-precision real-input spectrum matches a double-precision DFT
+  PowerScale powerScales[] = { Amplitude, dB };
+  for(int p = 0; p < 2; p++) {
+    SpectrumAnalyzerParameters parameters;
+    parameters.windowSize = 256;
+    parameters.windowOverlap = 0;
+    parameters.powerScale = powerScales[p];
+    SpectrumAnalyzer analyzer(parameters);
+    int n = parameters.windowSize;
+    std::vector<float> audio(n);
+    srand(4);
+    for(int i = 0; i < n; i++)
+      audio[i] = (float) (0.5 * sin(i * 0.3) + 0.2 * sin(i * 1.7) + 0.1 * rand() / RAND_MAX);
+    analyzer.feedAudioFrames(&audio[0], n);
+    CHECK_EQUAL(n / 2, analyzer.getSpectrumResolution());
+
+    const float *spectrum = analyzer.getSpectrum();
+    double dB_reference = 0.00001;
+    for(int k = 0; k < n / 2; k++) {
+      double r = 0, c = 0;
+      for(int i = 0; i < n; i++) {
+	double window = 0.35875 - 0.48829 * cos(2*M_PI*i/(n-1))
+	  + 0.14128 * cos(4*M_PI*i/(n-1)) - 0.01168 * cos(6*M_PI*i/(n-1));
+	r += audio[i] * window * cos(2*M_PI*k*i/n);
+	c -= audio[i] * window * sin(2*M_PI*k*i/n);
+      }
+      double power = r*r + c*c;
+      double expected;
+      if(powerScales[p] == Amplitude)
+	expected = sqrt(power) / n;
+      else
+	expected = (log10(power < dB_reference ? dB_reference : power) - log10(dB_reference))
+	  / (log10((double) n*n) - log10(dB_reference));
+      CHECK_CLOSE(expected, spectrum[k], 0.0001);
+    }
+  }
+}
+
+TEST(SpectrumAnalyzerHopPolicies) {
+  // fed several hops at once, LatestHopOnly transforms only the newest
+  // window, and EveryHop yields the spectra of hop-by-hop feeding
+  SpectrumAnalyzerParameters parameters;
+  parameters.windowSize = 256;
+  parameters.windowOverlap = 0.75f;
+  int hopSize = 64;
+  SpectrumAnalyzer latestHop(parameters);
+  SpectrumAnalyzer hopByHop(parameters);
+  parameters.hopPolicy = EveryHop;
+  SpectrumAnalyzer everyHop(parameters);
+  std::vector<float> audio(1000);
+  for(unsigned int i = 0; i < audio.size(); i++)
+    audio[i] = (float) (0.5 * sin(i * 0.3) + 0.2 * sin(i * 0.011 * i));
+
+  unsigned long blockSizes[] = { 10, 300, 690 }; // not aligned to hops
+  unsigned long offset = 0;
+  for(int b = 0; b < 3; b++) {
+    unsigned long numFrames = blockSizes[b];
+    unsigned long firstHop = offset / hopSize, endHop = (offset + numFrames) / hopSize;
+    latestHop.feedAudioFrames(&audio[offset], numFrames);
+    everyHop.feedAudioFrames(&audio[offset], numFrames);
+    CHECK_EQUAL(endHop > firstHop ? 1ul : 0ul, latestHop.getNumSpectra());
+    CHECK_EQUAL(endHop - firstHop, everyHop.getNumSpectra());
+
+    SpectrumAnalyzer::SpectrumIterator spectrum = everyHop.beginSpectra();
+    for(unsigned long hop = firstHop; hop < endHop; hop++) {
+      unsigned long hopStart = hop == firstHop ? offset : hop * hopSize;
+      hopByHop.feedAudioFrames(&audio[hopStart], (hop + 1) * hopSize - hopStart);
+      for(int k = 0; k < 128; k++)
+	CHECK_EQUAL(hopByHop.getSpectrum()[k], (*spectrum)[k]);
+      spectrum++;
+    }
+    CHECK(spectrum == everyHop.endSpectra());
+    unsigned long hopStart = endHop > firstHop ? endHop * hopSize : offset;
+    hopByHop.feedAudioFrames(&audio[hopStart], offset + numFrames - hopStart);
+    for(int k = 0; k < 128; k++) {
+      CHECK_EQUAL(hopByHop.getSpectrum()[k], latestHop.getSpectrum()[k]);
+      CHECK_EQUAL(hopByHop.getSpectrum()[k], everyHop.getSpectrum()[k]);
+    }
+    offset += numFrames;
+  }
+}
+
+TEST(SparseSpectrum) {
+  // a sparse spectrum agrees with the full one on the supported positions
+  SpectrumAnalyzerParameters parameters;
+  parameters.windowSize = 256;
+  parameters.windowOverlap = 0;
+  std::vector<float> audio(parameters.windowSize);
+  for(unsigned int i = 0; i < audio.size(); i++)
+    audio[i] = (float) (0.5 * sin(i * 0.3) + 0.2 * sin(i * 1.7));
+  unsigned int positions[] = { 3, 10, 11, 40, 100 };
+  std::vector<unsigned int> support(positions, positions + 5);
+  PowerScale powerScales[] = { Amplitude, dB };
+  for(int p = 0; p < 2; p++) {
+    parameters.powerScale = powerScales[p];
+    SpectrumAnalyzer full(parameters);
+    full.feedAudioFrames(&audio[0], audio.size());
+    SpectrumAnalyzer sparse(parameters);
+    sparse.setSpectrumSupport(support);
+    CHECK(sparse.isSparse());
+    sparse.feedAudioFrames(&audio[0], audio.size());
+    unsigned int s = 0;
+    for(int k = 0; k < 128; k++) {
+      if(s < support.size() && support[s] == (unsigned int) k) {
+	CHECK_EQUAL(full.getSpectrum()[k], sparse.getSpectrum()[k]);
+	s++;
+      }
+      else
+	CHECK_EQUAL(0.0f, sparse.getSpectrum()[k]);
+    }
+    sparse.setSpectrumSupport(std::vector<unsigned int>());
+    CHECK(!sparse.isSparse());
+  }
+
+  // the bin divider's values don't depend on the positions it doesn't use
+  AudioParameters audioParameters;
+  SpectrumAnalyzerParameters frontEndParameters;
+  frontEndParameters.windowSize = 4096;
+  SpectrumFrontEnd fullFrontEnd(audioParameters, frontEndParameters);
+  frontEndParameters.sparseSpectrum = true;
+  SpectrumFrontEnd sparseFrontEnd(audioParameters, frontEndParameters);
+  CHECK(sparseFrontEnd.getSpectrumAnalyzer()->isSparse());
+  std::vector<float> block(audioParameters.bufferSize);
+  for(int b = 0; b < 20; b++) {
+    for(unsigned int i = 0; i < block.size(); i++)
+      block[i] = (float) sin((b * block.size() + i) * 0.05);
+    fullFrontEnd.feedAudio(&block[0], block.size());
+    sparseFrontEnd.feedAudio(&block[0], block.size());
+  }
+  for(unsigned int i = 0; i < fullFrontEnd.getSpectrumBinDivider()->getNumBins(); i++)
+    CHECK_EQUAL(fullFrontEnd.getBinValues()[i], sparseFrontEnd.getBinValues()[i]);
+}
+
+static void *createSpectrumAnalyzer(void *arg) {
+  SpectrumAnalyzerParameters parameters;
+  parameters.windowSize = 1024;
+  return new SpectrumAnalyzer(parameters);
+}
+
+TEST(FFTPlannerSharedPlans) {
+  // analyzers of one size share a plan, also when created concurrently
+  const char *filename = "unittest_wisdom.fftw";
+  remove(filename);
+  CHECK(FFTPlanner::setWisdomFile(filename));
+  unsigned int numPlans = FFTPlanner::getNumPlans();
+  pthread_t threads[4];
+  for(int i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, createSpectrumAnalyzer, NULL);
+  SpectrumAnalyzer *analyzers[4];
+  for(int i = 0; i < 4; i++)
+    pthread_join(threads[i], (void **) &analyzers[i]);
+  CHECK_EQUAL(numPlans + 1, FFTPlanner::getNumPlans());
+  CHECK(FFTPlanner::getRealPlan(1024) == FFTPlanner::getRealPlan(1024));
+  CHECK(FFTPlanner::getRealPlan(1024) != FFTPlanner::getRealPlan(2048));
+
+  // the new plan was saved as wisdom
+  FILE *f = fopen(filename, "r");
+  CHECK(f != NULL);
+  if(f)
+    fclose(f);
+  CHECK(FFTPlanner::saveWisdom());
+  FFTPlanner::setWisdomFile("");
+  CHECK(!FFTPlanner::saveWisdom());
+  remove(filename);
+
+  // shared plans give every analyzer its own spectrum
+  std::vector<float> audio(1024, 0.0f), silence(1024, 0.0f);
+  for(int i = 0; i < 1024; i++)
+    audio[i] = (float) sin(i * 0.2);
+  analyzers[0]->feedAudioFrames(&audio[0], 1024);
+  analyzers[1]->feedAudioFrames(&silence[0], 1024);
+  CHECK(analyzers[0]->getSpectrum()[32] > 0.1f);
+  CHECK_CLOSE(0.0f, analyzers[1]->getSpectrum()[32], 0.000001f);
+  for(int i = 0; i < 4; i++)
+    delete analyzers[i];
+}
+
+TEST(MirroredCircularBuffer) {
+  // contents agree with a plain circular buffer, and are contiguous from the readhead
+  unsigned long sizes[] = { 5, 4096 }; // the latter fills whole pages and may be mapped
+  for(int s = 0; s < 2; s++) {
+    unsigned long size = sizes[s];
+    MirroredCircularBuffer<float> mirrored(size);
+    CircularBuffer<float> plain(size);
+    std::vector<float> items(3 * size), expected(size);
+    for(unsigned long i = 0; i < items.size(); i++)
+      items[i] = (float) i;
+    unsigned long chunkSizes[] = { 3, 1, size - 1, 2 * size + 1, 7 };
+    unsigned long offset = 0;
+    for(int c = 0; c < 5; c++) {
+      unsigned long n = chunkSizes[c] < items.size() - offset ? chunkSizes[c] : items.size() - offset;
+      mirrored.write(n, &items[offset]);
+      plain.write(n, &items[offset]);
+      mirrored.moveReadHead(n);
+      plain.moveReadHead(n);
+      offset = (offset + n) % size;
+      plain.read(size, &expected[0]);
+      const float *window = mirrored.getReadPointer();
+      for(unsigned long i = 0; i < size; i++)
+	CHECK_EQUAL(expected[i], window[i]);
+    }
+  }
+}
+
+static void *pushAudioBlocks(void *arg) {
+  AudioBlockQueue *queue = (AudioBlockQueue *) arg;
+  float block[16];
+  for(int n = 0; n < 10000; n++) {
+    for(int i = 0; i < 16; i++)
+      block[i] = (float) (n * 16 + i);
+    while(!queue->push(block)) {}
+  }
+  return NULL;
+}
+
+TEST(AudioBlockQueue) {
+  // a full queue drops blocks, an empty one returns none
+  AudioBlockQueue queue(16, 4);
+  float block[16], popped[16];
+  for(int i = 0; i < 16; i++)
+    block[i] = (float) i;
+  for(int n = 0; n < 4; n++)
+    CHECK(queue.push(block));
+  CHECK(!queue.push(block));
+  CHECK_EQUAL(1ul, queue.getNumOverruns());
+  CHECK_EQUAL(4ul, queue.getNumQueuedBlocks());
+  for(int n = 0; n < 4; n++)
+    CHECK(queue.pop(popped));
+  CHECK(!queue.pop(popped));
+  CHECK_EQUAL(1ul, queue.getNumUnderruns());
+  CHECK_EQUAL(0ul, queue.getNumQueuedBlocks());
+
+  // blocks handed over between threads arrive whole and in order
+  AudioBlockQueue threadedQueue(16, 4);
+  pthread_t producer;
+  pthread_create(&producer, NULL, pushAudioBlocks, &threadedQueue);
+  bool inOrder = true;
+  for(int n = 0; n < 10000; n++) {
+    while(!threadedQueue.pop(popped)) {}
+    for(int i = 0; i < 16; i++)
+      if(popped[i] != (float) (n * 16 + i))
+	inOrder = false;
+  }
+  pthread_join(producer, NULL);
+  CHECK(inOrder);
+}
+
 TEST(CircleSOM) {
   /*
       0